@@ -0,0 +1,391 @@
+/**************************************************************
+ *
+ *                     a2affine.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the warp engine.  The work is driven by the
+ *     destination: it is filled one tile at a time (a block for blocked
+ *     arrays, a TILE x TILE square for plain ones), and every cell is
+ *     a gather from wherever its centre maps back to in the source.
+ *     Neighbouring destination cells map to neighbouring source cells,
+ *     so a tile reads one compact patch of the source.  Along a row of
+ *     a tile the source position only ever moves by the same step, so
+ *     it is kept in 16.16 fixed point and advanced by adding, and the
+ *     bilinear blend is done in integers, four channels at a time with
+ *     SSE2 where it is available.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "assert.h"
+#include "a2affine.h"
+
+/* side of a destination tile for plain arrays, in cells */
+#define TILE 32
+
+/* bytes in a Pnm_rgb, the only cell the warp engine handles */
+#define RGB_SIZE 12
+
+/* source positions are 16.16 fixed point */
+#define FRAC_BITS 16
+#define FIXED_HALF ((int64_t)1 << (FRAC_BITS - 1))
+
+/*
+ * bilinear weights are 7 bits a side, so the four products of a blend
+ * add up to 1 << 14, and a 16-bit channel times one still fits in 32
+ */
+#define WEIGHT_BITS 7
+#define WEIGHT_ONE (1 << WEIGHT_BITS)
+#define BLEND_BITS (2 * WEIGHT_BITS)
+
+/* a map is taken as singular when its determinant is this small */
+#define EPSILON 1e-9
+
+typedef int64_t fixed;
+
+A2Affine A2Affine_identity(void)
+{
+        A2Affine m = {1, 0, 0, 1};
+        return m;
+}
+
+/********** A2Affine_rotation ********
+ *
+ * Builds a clockwise turn
+ *
+ * Parameters:
+ *      double degrees: the angle, any sign or size
+ *
+ * Return:
+ *      the map
+ *
+ * Notes:
+ *      multiples of 90 degrees come out exact, so a quarter turn
+ *      resampled with A2_NEAREST moves pixels exactly as -rotate does
+ ************************/
+A2Affine A2Affine_rotation(double degrees)
+{
+        double turn = fmod(degrees, 360.0);
+        double s, c;
+
+        if (turn < 0) {
+                turn += 360.0;
+        }
+        if (turn == 0.0) {
+                s = 0, c = 1;
+        } else if (turn == 90.0) {
+                s = 1, c = 0;
+        } else if (turn == 180.0) {
+                s = 0, c = -1;
+        } else if (turn == 270.0) {
+                s = -1, c = 0;
+        } else {
+                double radians = turn * M_PI / 180.0;
+                s = sin(radians);
+                c = cos(radians);
+        }
+
+        /* with y pointing down, this matrix turns clockwise */
+        A2Affine m = {c, -s, s, c};
+        return m;
+}
+
+A2Affine A2Affine_of(A2Transform_T kind)
+{
+        static const A2Affine maps[] = {
+                [A2_ROTATE_0]        = { 1,  0,  0,  1},
+                [A2_ROTATE_90]       = { 0, -1,  1,  0},
+                [A2_ROTATE_180]      = {-1,  0,  0, -1},
+                [A2_ROTATE_270]      = { 0,  1, -1,  0},
+                [A2_FLIP_HORIZONTAL] = {-1,  0,  0,  1},
+                [A2_FLIP_VERTICAL]   = { 1,  0,  0, -1},
+                [A2_TRANSPOSE]       = { 0,  1,  1,  0},
+                [A2_TRANSVERSE]      = { 0, -1, -1,  0},
+        };
+        assert((unsigned)kind <= A2_TRANSVERSE);
+        return maps[kind];
+}
+
+A2Affine A2Affine_compose(A2Affine first, A2Affine second)
+{
+        A2Affine m = {
+                second.a * first.a + second.b * first.c,
+                second.a * first.b + second.b * first.d,
+                second.c * first.a + second.d * first.c,
+                second.c * first.b + second.d * first.d
+        };
+        return m;
+}
+
+static double determinant(A2Affine m)
+{
+        return m.a * m.d - m.b * m.c;
+}
+
+bool A2Affine_invertible(A2Affine m)
+{
+        double det = determinant(m);
+        return isfinite(det) && fabs(det) > EPSILON;
+}
+
+static A2Affine inverse(A2Affine m)
+{
+        double det = determinant(m);
+        A2Affine inv = {m.d / det, -m.b / det, -m.c / det, m.a / det};
+        return inv;
+}
+
+/* the box the corners of a width x height image are mapped into */
+static void bounds(A2Affine m, int width, int height, double *min_x,
+                   double *min_y, double *max_x, double *max_y)
+{
+        double xs[4] = {0, m.a * width, m.b * height,
+                        m.a * width + m.b * height};
+        double ys[4] = {0, m.c * width, m.d * height,
+                        m.c * width + m.d * height};
+
+        *min_x = *max_x = 0;
+        *min_y = *max_y = 0;
+        for (int i = 1; i < 4; i++) {
+                *min_x = fmin(*min_x, xs[i]);
+                *max_x = fmax(*max_x, xs[i]);
+                *min_y = fmin(*min_y, ys[i]);
+                *max_y = fmax(*max_y, ys[i]);
+        }
+}
+
+/* cells needed to cover 'extent', ignoring rounding noise */
+static int cover(double extent)
+{
+        double cells = ceil(extent - 1e-6);
+        assert(cells < INT32_MAX);
+        return cells < 1 ? 1 : (int)cells;
+}
+
+void A2Affine_dims(A2Affine m, int width, int height, int *new_width,
+                   int *new_height)
+{
+        double min_x, min_y, max_x, max_y;
+
+        assert(new_width != NULL && new_height != NULL);
+        bounds(m, width, height, &min_x, &min_y, &max_x, &max_y);
+        *new_width = cover(max_x - min_x);
+        *new_height = cover(max_y - min_y);
+}
+
+static inline fixed to_fixed(double x)
+{
+        return (fixed)llround(x * (double)((int64_t)1 << FRAC_BITS));
+}
+
+/* the whole part of x, rounding down for negative x as well */
+static inline int64_t floor_fixed(fixed x)
+{
+        return x >= 0 ? x >> FRAC_BITS : ~(~x >> FRAC_BITS);
+}
+
+static inline int64_t clamp(int64_t x, int64_t hi)
+{
+        return x < 0 ? 0 : x > hi ? hi : x;
+}
+
+static inline const char *cell_at(const A2Layout *src, int64_t col,
+                                  int64_t row)
+{
+        if (src->blocksize == 1) {
+                return src->base
+                       + ((size_t)row * src->width + col) * RGB_SIZE;
+        }
+        return A2Layout_at(src, col, row);
+}
+
+#if defined(__SSE2__)
+
+/* the three channels of a cell in the low three lanes, without reading
+ * past its 12 bytes */
+static inline __m128i load_rgb(const char *cell)
+{
+        int32_t blue;
+        memcpy(&blue, cell + 8, sizeof(blue));
+        return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)cell),
+                                  _mm_cvtsi32_si128(blue));
+}
+
+/*
+ * each lane times weight, for lanes and weight below 65536: SSE2 has
+ * no 32-bit multiply, but with the top halves zero the 16-bit low and
+ * high products are the two halves of the answer
+ */
+static inline __m128i scale(__m128i rgb, int weight)
+{
+        __m128i w = _mm_set1_epi32(weight);
+        __m128i lo = _mm_mullo_epi16(rgb, w);
+        __m128i hi = _mm_mulhi_epu16(rgb, w);
+        return _mm_or_si128(lo, _mm_slli_epi32(hi, 16));
+}
+
+static inline void blend(const char *p00, const char *p10, const char *p01,
+                         const char *p11, int fx, int fy, char *out)
+{
+        __m128i sum = _mm_set1_epi32(1 << (BLEND_BITS - 1));
+        sum = _mm_add_epi32(sum, scale(load_rgb(p00),
+                                       (WEIGHT_ONE - fx) * (WEIGHT_ONE - fy)));
+        sum = _mm_add_epi32(sum, scale(load_rgb(p10),
+                                       fx * (WEIGHT_ONE - fy)));
+        sum = _mm_add_epi32(sum, scale(load_rgb(p01),
+                                       (WEIGHT_ONE - fx) * fy));
+        sum = _mm_add_epi32(sum, scale(load_rgb(p11), fx * fy));
+        sum = _mm_srli_epi32(sum, BLEND_BITS);
+
+        int32_t blue = _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+        _mm_storel_epi64((__m128i *)out, sum);
+        memcpy(out + 8, &blue, sizeof(blue));
+}
+
+#else
+
+static inline void blend(const char *p00, const char *p10, const char *p01,
+                         const char *p11, int fx, int fy, char *out)
+{
+        uint32_t c00[3], c10[3], c01[3], c11[3], result[3];
+        uint32_t w00 = (WEIGHT_ONE - fx) * (WEIGHT_ONE - fy);
+        uint32_t w10 = fx * (WEIGHT_ONE - fy);
+        uint32_t w01 = (WEIGHT_ONE - fx) * fy;
+        uint32_t w11 = fx * fy;
+
+        memcpy(c00, p00, RGB_SIZE);
+        memcpy(c10, p10, RGB_SIZE);
+        memcpy(c01, p01, RGB_SIZE);
+        memcpy(c11, p11, RGB_SIZE);
+        for (int i = 0; i < 3; i++) {
+                result[i] = (c00[i] * w00 + c10[i] * w10 + c01[i] * w01
+                             + c11[i] * w11 + (1 << (BLEND_BITS - 1)))
+                            >> BLEND_BITS;
+        }
+        memcpy(out, result, RGB_SIZE);
+}
+
+#endif
+
+/* the four cells around source position (u, v), clamped at the edges */
+static inline void bilinear(const A2Layout *src, fixed u, fixed v, char *out)
+{
+        /* round to the nearest weight step rather than truncating */
+        u += (fixed)1 << (FRAC_BITS - WEIGHT_BITS - 1);
+        v += (fixed)1 << (FRAC_BITS - WEIGHT_BITS - 1);
+
+        int64_t x0 = floor_fixed(u);
+        int64_t y0 = floor_fixed(v);
+        int fx = (int)((u - x0 * ((int64_t)1 << FRAC_BITS))
+                       >> (FRAC_BITS - WEIGHT_BITS));
+        int fy = (int)((v - y0 * ((int64_t)1 << FRAC_BITS))
+                       >> (FRAC_BITS - WEIGHT_BITS));
+        int64_t x1 = clamp(x0 + 1, src->width - 1);
+        int64_t y1 = clamp(y0 + 1, src->height - 1);
+        x0 = clamp(x0, src->width - 1);
+        y0 = clamp(y0, src->height - 1);
+
+        blend(cell_at(src, x0, y0), cell_at(src, x1, y0),
+              cell_at(src, x0, y1), cell_at(src, x1, y1), fx, fy, out);
+}
+
+/********** warp_span ********
+ *
+ * Fills count adjacent destination cells of one row
+ *
+ * Parameters:
+ *      A2Sampling_T sampling: nearest or bilinear
+ *      const A2Layout *src: the source image
+ *      char *out: the first destination cell; the rest follow it
+ *      int count: cells to fill
+ *      fixed u, v: where the first cell's centre lands in src, in
+ *                  cells, with the centre of cell (0, 0) at (0, 0)
+ *      fixed du, dv: how far that moves per destination cell
+ *
+ * Notes:
+ *      a cell is inside the image when its nearest source cell is, so
+ *      nearest and bilinear sampling cover exactly the same cells
+ ************************/
+static void warp_span(A2Sampling_T sampling, const A2Layout *src, char *out,
+                      int count, fixed u, fixed v, fixed du, fixed dv)
+{
+        for (int i = 0; i < count; i++, u += du, v += dv, out += RGB_SIZE) {
+                int64_t col = floor_fixed(u + FIXED_HALF);
+                int64_t row = floor_fixed(v + FIXED_HALF);
+
+                if (col < 0 || col >= src->width
+                    || row < 0 || row >= src->height) {
+                        memset(out, 0, RGB_SIZE);
+                } else if (sampling == A2_NEAREST) {
+                        memcpy(out, cell_at(src, col, row), RGB_SIZE);
+                } else {
+                        bilinear(src, u, v, out);
+                }
+        }
+}
+
+/********** A2Affine_apply ********
+ *
+ * Resamples src through m into dst
+ *
+ * Parameters:
+ *      A2Affine m: the map, taking src to dst
+ *      A2Sampling_T sampling: nearest or bilinear
+ *      A2Layout src, dst: the images
+ *
+ * Expects:
+ *      m invertible; dst of the dimensions A2Affine_dims gives; both
+ *      with Pnm_rgb-sized cells (checked runtime errors)
+ *
+ * Notes:
+ *      The destination is visited tile by tile.  Each row of a tile is
+ *      contiguous in dst, and its starting source position is worked
+ *      out afresh in floating point, so the fixed-point steps never
+ *      accumulate error over more than one tile width.
+ ************************/
+void A2Affine_apply(A2Affine m, A2Sampling_T sampling, A2Layout src,
+                    A2Layout dst)
+{
+        int new_width, new_height;
+        double min_x, min_y, max_x, max_y;
+
+        assert(A2Affine_invertible(m));
+        assert(src.size == RGB_SIZE && dst.size == RGB_SIZE);
+        A2Affine_dims(m, src.width, src.height, &new_width, &new_height);
+        assert(dst.width == new_width && dst.height == new_height);
+        bounds(m, src.width, src.height, &min_x, &min_y, &max_x, &max_y);
+
+        A2Affine inv = inverse(m);
+        fixed du = to_fixed(inv.a);
+        fixed dv = to_fixed(inv.c);
+        int tile = dst.blocksize > 1 ? dst.blocksize : TILE;
+
+        for (int ty = 0; ty < dst.height; ty += tile) {
+                int row_end = ty + tile < dst.height ? ty + tile : dst.height;
+                for (int tx = 0; tx < dst.width; tx += tile) {
+                        int count = tx + tile < dst.width
+                                    ? tile : dst.width - tx;
+                        for (int row = ty; row < row_end; row++) {
+                                /* centre of (tx, row) back in src */
+                                double x = tx + 0.5 + min_x;
+                                double y = row + 0.5 + min_y;
+                                double u = inv.a * x + inv.b * y - 0.5;
+                                double v = inv.c * x + inv.d * y - 0.5;
+                                warp_span(sampling, &src,
+                                          A2Layout_at(&dst, tx, row), count,
+                                          to_fixed(u), to_fixed(v), du, dv);
+                        }
+                }
+        }
+}
@@ -0,0 +1,77 @@
+/**************************************************************
+ *
+ *                     a2affine.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to the warp engine: turns an image through any angle,
+ *     or any invertible linear map, by resampling it.  Like the
+ *     transform engine it works on A2Layouts, so it reads and writes
+ *     the storage of plain and blocked arrays directly.
+ *
+ **************************************************************/
+
+#ifndef A2AFFINE_INCLUDED
+#define A2AFFINE_INCLUDED
+
+#include <stdbool.h>
+
+#include "a2transform.h"
+
+/*
+ * the linear part of an affine map, taking the point (x, y) of the
+ * source image to
+ *
+ *     x' = a * x + b * y
+ *     y' = c * x + d * y
+ *
+ * with y pointing down the image.  The destination is always sized and
+ * placed to hold the whole transformed image, so a translation would
+ * have no effect and there is none.
+ */
+typedef struct A2Affine {
+        double a, b, c, d;
+} A2Affine;
+
+/* how a destination pixel that falls between source pixels is filled */
+typedef enum A2Sampling_T {
+        A2_NEAREST,
+        A2_BILINEAR
+} A2Sampling_T;
+
+extern A2Affine A2Affine_identity(void);
+
+/* a clockwise turn by 'degrees', the same direction as -rotate */
+extern A2Affine A2Affine_rotation(double degrees);
+
+/* the map that moves every pixel the way 'kind' does */
+extern A2Affine A2Affine_of(A2Transform_T kind);
+
+/* the single map that has the same effect as applying first and then
+ * second
+ */
+extern A2Affine A2Affine_compose(A2Affine first, A2Affine second);
+
+/* true if the map can be undone, which A2Affine_apply needs */
+extern bool A2Affine_invertible(A2Affine m);
+
+/*
+ * width and height of the smallest image holding a width x height
+ * image after m (at least 1 x 1)
+ */
+extern void A2Affine_dims(A2Affine m, int width, int height,
+                          int *new_width, int *new_height);
+
+/*
+ * fills every cell of dst by mapping its centre back through m into
+ * src and sampling there; cells that land outside src become zero.
+ * Cells must be three unsigned channels below 65536 (a struct
+ * Pnm_rgb), dst must have the dimensions given by A2Affine_dims, and
+ * m must be invertible (checked runtime errors)
+ */
+extern void A2Affine_apply(A2Affine m, A2Sampling_T sampling, A2Layout src,
+                           A2Layout dst);
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <a2blocked.h>
 #include "uarray2b.h"
+#include "a2transform.h"
 
 // define a private version of each function in A2Methods_T that we implement
 
@@ -52,25 +53,89 @@ static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
         UArray2b_map(array2, (applyfun *) apply, cl);
 }
 
+typedef void spanfun(void *elem, int count, int col, int row, void *cl);
+
+static void map_spans_block_major(A2 array2, A2Methods_spanapplyfun apply,
+                                  void *cl)
+{
+        UArray2b_map_spans(array2, (spanfun *) apply, cl);
+}
+
 struct small_closure {
         A2Methods_smallapplyfun *apply;
         void *cl;
+        int size;
 };
 
-static void apply_small(int i, int j, UArray2b_T array2, void *elem, void *vcl)
+/* walks one block row, so apply is the only indirect call per cell */
+static void apply_small_span(void *elem, int count, int col, int row,
+                             void *vcl)
 {
         struct small_closure *cl = vcl;
-        (void)i;
-        (void)j;
-        (void)array2;
-        cl->apply(elem, cl->cl);
+        char *p = elem;
+        (void)col;
+        (void)row;
+        for (int i = 0; i < count; i++) {
+                cl->apply(p, cl->cl);
+                p += cl->size;
+        }
 }
 
 static void small_map_block_major(A2 a2, A2Methods_smallapplyfun apply,
                                   void *cl)
 {
-        struct small_closure mycl = { apply, cl };
-        UArray2b_map(a2, apply_small, &mycl);
+        struct small_closure mycl = { apply, cl, UArray2b_size(a2) };
+        UArray2b_map_spans(a2, apply_small_span, &mycl);
+}
+
+/* blocked storage is exactly the A2Layout order with bs = blocksize */
+static A2Layout layout(UArray2b_T array2)
+{
+        return A2Layout_new(UArray2b_at(array2, 0, 0),
+                            UArray2b_width(array2), UArray2b_height(array2),
+                            UArray2b_size(array2), UArray2b_blocksize(array2));
+}
+
+static A2 transform(A2 array2, A2Transform_T kind)
+{
+        int new_width, new_height;
+        A2Transform_dims(kind, UArray2b_width(array2),
+                         UArray2b_height(array2), &new_width, &new_height);
+
+        UArray2b_T result = UArray2b_new(new_width, new_height,
+                                         UArray2b_size(array2),
+                                         UArray2b_blocksize(array2));
+        A2Transform_apply(kind, layout(array2), layout(result));
+        return result;
+}
+
+static A2 rotate90(A2 array2)
+{
+        return transform(array2, A2_ROTATE_90);
+}
+static A2 rotate180(A2 array2)
+{
+        return transform(array2, A2_ROTATE_180);
+}
+static A2 rotate270(A2 array2)
+{
+        return transform(array2, A2_ROTATE_270);
+}
+static A2 flip_h(A2 array2)
+{
+        return transform(array2, A2_FLIP_HORIZONTAL);
+}
+static A2 flip_v(A2 array2)
+{
+        return transform(array2, A2_FLIP_VERTICAL);
+}
+static A2 transpose(A2 array2)
+{
+        return transform(array2, A2_TRANSPOSE);
+}
+static A2 transverse(A2 array2)
+{
+        return transform(array2, A2_TRANSVERSE);
 }
 
 static struct A2Methods_T uarray2_methods_blocked_struct = {
@@ -90,6 +155,15 @@ static struct A2Methods_T uarray2_methods_blocked_struct = {
         NULL,                   // small_map_col_major
         small_map_block_major,
         small_map_block_major,  // small_map_default
+        NULL,                   // map_spans_row_major
+        map_spans_block_major,
+        rotate90,
+        rotate180,
+        rotate270,
+        flip_h,
+        flip_v,
+        transpose,
+        transverse,
 };
 
 // finally the payoff: here is the exported pointer to the struct
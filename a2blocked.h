@@ -1,12 +1,7 @@
+#ifndef A2BLOCKED_INCLUDED
+#define A2BLOCKED_INCLUDED
+#include "a2methods.h"
 
+extern A2Methods_T uarray2_methods_blocked; // functions for blocked arrays
 
-
-
-static A2 new(int width, int height, int size);
-static A2 new_with_blocksize(int width, int height, int size, int blocksize);
-static void a2free(A2 * array2p);
-static int width(A2 array2);
-static int height(A2 array2);
-
-
-
+#endif
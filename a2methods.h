@@ -0,0 +1,107 @@
+#ifndef A2METHODS_INCLUDED
+#define A2METHODS_INCLUDED
+
+/*
+ * Local copy of the course A2Methods interface (like uarray.h).
+ * New slots only ever go at the END of struct A2Methods_T so that
+ * the course libraries (libpnm reads new, at, map_default, ...) keep
+ * seeing the fields at the offsets they were compiled against.
+ */
+
+#define A2 A2Methods_UArray2    // private abbreviation
+typedef void *A2;               // unknown type that represents a 2D array
+
+typedef void A2Methods_Object;  // unknown type of element stored in an A2
+
+/*
+ * apply function suitable for use with any sort of mapping function
+ */
+typedef void A2Methods_applyfun(int i, int j, A2 array2,
+                                A2Methods_Object *ptr, void *cl);
+
+typedef void A2Methods_mapfun(A2 array2, A2Methods_applyfun apply, void *cl);
+
+/* apply and map functions for when you don't care about i, j, or array2 */
+typedef void A2Methods_smallapplyfun(A2Methods_Object *ptr, void *cl);
+typedef void A2Methods_smallmapfun(A2 a2, A2Methods_smallapplyfun apply,
+                                   void *cl);
+
+/*
+ * span apply function: called once per run of 'count' cells that sit
+ * next to each other in memory.  'ptr' is the cell at (col, row) and
+ * the rest of the run are cells (col + 1, row) ... (col + count - 1, row),
+ * each 'size' bytes after the last.
+ */
+typedef void A2Methods_spanapplyfun(A2Methods_Object *ptr, int count,
+                                    int col, int row, void *cl);
+typedef void A2Methods_spanmapfun(A2 array2, A2Methods_spanapplyfun apply,
+                                  void *cl);
+
+/*
+ * transform function: returns a new array of the same representation
+ * (and blocksize) holding the transformed image of array2; the caller
+ * frees it with the suite's free
+ */
+typedef A2 A2Methods_transformfun(A2 array2);
+
+/*
+ * a method suite that can be used with either plain or blocked arrays
+ */
+typedef const struct A2Methods_T {
+        /* creates a distinct 2D array of memory cells, each of the given
+         * 'size'; each cell is uninitialized.  If the array is blocked,
+         * blocksize is as large as possible with blocks of at most 64KB
+         */
+        A2 (*new)(int width, int height, int size);
+        /* creates a distinct 2D array with a stated blocksize */
+        A2 (*new_with_blocksize)(int width, int height, int size,
+                                 int blocksize);
+        /* frees *array2p and overwrites the pointer with NULL */
+        void (*free)(A2 *array2p);
+
+        /* observe properties of the array */
+        int (*width)    (A2 array2);
+        int (*height)   (A2 array2);
+        int (*size)     (A2 array2);
+        int (*blocksize)(A2 array2);    /* for an unblocked array, returns 1 */
+
+        /* returns a pointer to the object in column i, row j
+         * (checked runtime error if i or j is out of bounds)
+         */
+        A2Methods_Object *(*at)(A2 array2, int i, int j);
+
+        /* mapping functions; a NULL entry means the order is not
+         * supported by this representation
+         */
+        A2Methods_mapfun *map_row_major;
+        A2Methods_mapfun *map_col_major;
+        A2Methods_mapfun *map_block_major;
+        A2Methods_mapfun *map_default;  /* uses the best-performing order */
+
+        A2Methods_smallmapfun *small_map_row_major;
+        A2Methods_smallmapfun *small_map_col_major;
+        A2Methods_smallmapfun *small_map_block_major;
+        A2Methods_smallmapfun *small_map_default;
+
+        /* span mapping functions: call apply once per contiguous run of
+         * cells instead of once per cell.  Plain arrays hand out whole
+         * rows; blocked arrays hand out one row of one block at a time.
+         */
+        A2Methods_spanmapfun *map_spans_row_major;
+        A2Methods_spanmapfun *map_spans_block_major;
+
+        /* transforms implemented natively by the representation; a NULL
+         * entry means the caller has to map the image cell by cell
+         */
+        A2Methods_transformfun *rotate90;
+        A2Methods_transformfun *rotate180;
+        A2Methods_transformfun *rotate270;
+        A2Methods_transformfun *flip_h;
+        A2Methods_transformfun *flip_v;
+        A2Methods_transformfun *transpose;
+        A2Methods_transformfun *transverse;     /* anti-transpose */
+} *A2Methods_T;
+
+#undef A2
+
+#endif
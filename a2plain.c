@@ -1,7 +1,12 @@
 #include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #include <a2plain.h>
 #include "uarray2.h"
+#include "a2transform.h"
+
+typedef A2Methods_UArray2 A2;   // private abbreviation
 
 /************************************************/
 /* Define a private version of each function in */
@@ -38,14 +43,17 @@ static int size(A2 array2)
 {
         return UArray2_size(array2);
 }
+static int blocksize(A2 array2)
+{
+        (void) array2;
+        return 1;
+}
 
 static A2Methods_Object *at(A2 array2, int i, int j)
 {
-        return UArray2b_at(array2, i, j);
+        return UArray2_at(array2, i, j);
 }
 
-typedef void applyfun(int i, int j, UArray2b_T array2b, void *elem, void *cl);
-
 /* TODO: ...many more private (static) definitions follow */
 
 static void map_row_major(A2Methods_UArray2 uarray2,
@@ -62,9 +70,35 @@ static void map_col_major(A2Methods_UArray2 uarray2,
         UArray2_map_col_major(uarray2, (UArray2_applyfun*)apply, cl);
 }
 
+/* A row is handed out as one run when UArray2 stores it contiguously
+ * (the row-major formula); otherwise each cell is a run of one
+ */
+static void map_spans_row_major(A2Methods_UArray2 uarray2,
+                                A2Methods_spanapplyfun apply,
+                                void *cl)
+{
+        int width = UArray2_width(uarray2);
+        int height = UArray2_height(uarray2);
+        int size = UArray2_size(uarray2);
+
+        for (int row = 0; row < height; row++) {
+                char *first = UArray2_at(uarray2, 0, row);
+                char *last = UArray2_at(uarray2, width - 1, row);
+
+                if (last - first == (width - 1) * size) {
+                        apply(first, width, 0, row, cl);
+                        continue;
+                }
+                for (int col = 0; col < width; col++) {
+                        apply(UArray2_at(uarray2, col, row), 1, col, row, cl);
+                }
+        }
+}
+
 struct small_closure {
         A2Methods_smallapplyfun *apply; 
         void *cl;
+        int size;
 };
 
 static void apply_small(int i, int j, UArray2_T uarray2,
@@ -77,41 +111,139 @@ static void apply_small(int i, int j, UArray2_T uarray2,
         cl->apply(elem, cl->cl);
 }
 
+/* walks one whole row, so apply is the only indirect call per cell */
+static void apply_small_span(A2Methods_Object *elem, int count, int col,
+                             int row, void *vcl)
+{
+        struct small_closure *cl = vcl;
+        char *p = elem;
+        (void)col;
+        (void)row;
+        for (int i = 0; i < count; i++) {
+                cl->apply(p, cl->cl);
+                p += cl->size;
+        }
+}
+
 static void small_map_row_major(A2Methods_UArray2        a2,
                                 A2Methods_smallapplyfun  apply,
                                 void *cl)
 {
-        struct small_closure mycl = { apply, cl };
-        UArray2_map_row_major(a2, apply_small, &mycl);
+        struct small_closure mycl = { apply, cl, UArray2_size(a2) };
+        map_spans_row_major(a2, apply_small_span, &mycl);
 }
 
 static void small_map_col_major(A2Methods_UArray2        a2,
                                 A2Methods_smallapplyfun  apply,
                                 void *cl)
 {
-        struct small_closure mycl = { apply, cl };
+        struct small_closure mycl = { apply, cl, UArray2_size(a2) };
         UArray2_map_col_major(a2, apply_small, &mycl);
 }
 
 
+/* true when UArray2 keeps all cells in one row-major run, which lets
+ * the transform engine treat the array as an A2Layout with bs = 1
+ */
+static bool is_dense(UArray2_T uarray2)
+{
+        int w = UArray2_width(uarray2);
+        int h = UArray2_height(uarray2);
+        char *first = UArray2_at(uarray2, 0, 0);
+        char *last = UArray2_at(uarray2, w - 1, h - 1);
+
+        return last - first == ((ptrdiff_t)w * h - 1) * UArray2_size(uarray2);
+}
+
+static A2Layout layout(UArray2_T uarray2)
+{
+        return A2Layout_new(UArray2_at(uarray2, 0, 0), UArray2_width(uarray2),
+                            UArray2_height(uarray2), UArray2_size(uarray2), 1);
+}
+
+static A2 transform(A2 array2, A2Transform_T kind)
+{
+        int w = UArray2_width(array2);
+        int h = UArray2_height(array2);
+        int size = UArray2_size(array2);
+        int new_width, new_height;
+        A2Transform_dims(kind, w, h, &new_width, &new_height);
+
+        UArray2_T result = UArray2_new(new_width, new_height, size);
+
+        if (is_dense(array2) && is_dense(result)) {
+                A2Transform_apply(kind, layout(array2), layout(result));
+                return result;
+        }
+
+        /* unknown storage order: fall back on UArray2_at for every cell */
+        for (int row = 0; row < h; row++) {
+                for (int col = 0; col < w; col++) {
+                        int new_col, new_row;
+                        A2Transform_at(kind, w, h, col, row, &new_col,
+                                       &new_row);
+                        memcpy(UArray2_at(result, new_col, new_row),
+                               UArray2_at(array2, col, row), size);
+                }
+        }
+        return result;
+}
+
+static A2 rotate90(A2 array2)
+{
+        return transform(array2, A2_ROTATE_90);
+}
+static A2 rotate180(A2 array2)
+{
+        return transform(array2, A2_ROTATE_180);
+}
+static A2 rotate270(A2 array2)
+{
+        return transform(array2, A2_ROTATE_270);
+}
+static A2 flip_h(A2 array2)
+{
+        return transform(array2, A2_FLIP_HORIZONTAL);
+}
+static A2 flip_v(A2 array2)
+{
+        return transform(array2, A2_FLIP_VERTICAL);
+}
+static A2 transpose(A2 array2)
+{
+        return transform(array2, A2_TRANSPOSE);
+}
+static A2 transverse(A2 array2)
+{
+        return transform(array2, A2_TRANSVERSE);
+}
+
 static struct A2Methods_T uarray2_methods_plain_struct = {
         new,
-        new_with_blocksize, //NULL?
+        new_with_blocksize,
         a2free,
         width,
         height,
         size,
-        NULL                            //blocksize
+        blocksize,
         at,
         map_row_major,                   // map_row_major
         map_col_major,                   // map_col_major
-        NULL,
-        NULL,// map_block_major,        // map_default
+        NULL,                            // map_block_major
+        map_row_major,                   // map_default
         small_map_row_major,            
         small_map_col_major,                   
-        NULL // small_map_block_major,
-        NULL //small_map_block_major,  // small_map_default
-
+        NULL,                            // small_map_block_major
+        small_map_row_major,             // small_map_default
+        map_spans_row_major,
+        NULL,                            // map_spans_block_major
+        rotate90,
+        rotate180,
+        rotate270,
+        flip_h,
+        flip_v,
+        transpose,
+        transverse,
 };
 
 // finally the payoff: here is the exported pointer to the struct
@@ -0,0 +1,272 @@
+/**************************************************************
+ *
+ *                     a2plan.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of transform plans.  The address of a cell in an
+ *     A2Layout splits into a part that depends on the column alone and
+ *     a part that depends on the row alone:
+ *
+ *         ((col / bs) * bs * bs + col % bs) * size
+ *       + ((row / bs) * blocks_wide * bs * bs + (row % bs) * bs) * size
+ *
+ *     and each of the eight transforms sends a source column to a
+ *     destination column or row, and a source row to the other one.  So
+ *     the destination of source cell (col, row) is dst_col[col] +
+ *     dst_row[row] for two tables of the destination offsets, and its
+ *     source is src_col[col] + src_row[row].  For a blocked array the
+ *     tables hold where each block starts plus where the cell sits in
+ *     it, which is the block permutation of the transform and the
+ *     permutation within a block in one.
+ *
+ *     The tables only pay for a blocked source, where they replace a
+ *     division and a remainder by the block size per coordinate.  A
+ *     plain layout's generated kernel is already a multiply-add per
+ *     cell, and the engines of a2transform.c (the 4 x 4 quarter turns
+ *     and the row reversals) move several cells per instruction, so
+ *     for those the plan builds no tables and runs the same code
+ *     A2Transform_traverse would, after the one check of the shapes.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "a2plan.h"
+
+#define T A2Plan_T
+
+/* side of a tile of a plain source, in cells, as in a2transform.c */
+#define TILE 32
+
+/* bytes in a Pnm_rgb and in a packed pixel, the cells the copy is
+ * specialised for */
+#define RGB_SIZE 12
+#define PACKED_SIZE 4
+
+struct T {
+        A2Transform_T kind;
+        A2Traversal_T order;
+        int width, height, size;        /* of the source */
+        int src_bs;
+        int dst_width, dst_height, dst_bs;
+        int tile;                       /* rows and columns of a tile */
+        /* byte offsets by source column and source row; NULL when the
+         * transform engine does better without them */
+        size_t *src_col, *src_row, *dst_col, *dst_row;
+};
+
+/* the part of a cell's offset that comes from its column */
+static size_t col_offset(const A2Layout *layout, int col)
+{
+        size_t bs = layout->blocksize;
+        return ((col / bs) * bs * bs + col % bs) * layout->size;
+}
+
+/* the part of a cell's offset that comes from its row */
+static size_t row_offset(const A2Layout *layout, int row)
+{
+        size_t bs = layout->blocksize;
+        return ((row / bs) * layout->blocks_wide * bs * bs + (row % bs) * bs)
+               * layout->size;
+}
+
+/* true if kind sends source columns to destination rows */
+static bool swaps_axes(A2Transform_T kind)
+{
+        return kind == A2_ROTATE_90 || kind == A2_ROTATE_270
+               || kind == A2_TRANSPOSE || kind == A2_TRANSVERSE;
+}
+
+/********** A2Plan_new ********
+ *
+ * Works out where every source column and row is, and goes, for one
+ * pair of array shapes
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      A2Traversal_T order: the order execution visits the source in
+ *      A2Layout src, dst: arrays of the shapes to plan for; their
+ *                         storage is not touched
+ *
+ * Return:
+ *      the plan, to be freed with A2Plan_free
+ *
+ * Expects:
+ *      dst has the dimensions A2Transform_dims gives and src's cell
+ *      size (checked runtime error)
+ *
+ * Notes:
+ *      The destination tables come from A2Transform_at, one call per
+ *      source column and per source row, so the plan moves cells
+ *      exactly where every other path does.  There are none for a
+ *      plain source or for a transform and order the engine has a
+ *      vectorised path for.
+ ************************/
+T A2Plan_new(A2Transform_T kind, A2Traversal_T order, A2Layout src,
+             A2Layout dst)
+{
+        int w = src.width, h = src.height;
+        int new_width, new_height;
+        A2Transform_dims(kind, w, h, &new_width, &new_height);
+        assert(dst.width == new_width && dst.height == new_height);
+        assert(dst.size == src.size);
+        assert(order >= A2_ROW_MAJOR && order <= A2_BLOCK_MAJOR);
+
+        T plan = malloc(sizeof(*plan));
+        assert(plan != NULL);
+        plan->kind = kind;
+        plan->order = order;
+        plan->width = w;
+        plan->height = h;
+        plan->size = src.size;
+        plan->src_bs = src.blocksize;
+        plan->dst_width = dst.width;
+        plan->dst_height = dst.height;
+        plan->dst_bs = dst.blocksize;
+        plan->tile = src.blocksize > 1 ? src.blocksize : TILE;
+        plan->src_col = plan->src_row = plan->dst_col = plan->dst_row = NULL;
+        if (src.blocksize == 1 || dst.blocksize == 1
+            || A2Transform_has_engine(kind, order, src.size)) {
+                return plan;
+        }
+
+        /* one allocation for all four tables; +1 so a 0 x 0 image
+         * still gets a pointer that can be freed */
+        size_t *tables = malloc((2 * ((size_t)w + h) + 1) * sizeof(size_t));
+        assert(tables != NULL);
+        plan->src_col = tables;
+        plan->dst_col = tables + w;
+        plan->src_row = tables + 2 * (size_t)w;
+        plan->dst_row = tables + 2 * (size_t)w + h;
+
+        bool swap = swaps_axes(kind);
+        for (int col = 0; col < w; col++) {
+                int new_col, new_row;
+                A2Transform_at(kind, w, h, col, 0, &new_col, &new_row);
+                plan->src_col[col] = col_offset(&src, col);
+                plan->dst_col[col] = swap ? row_offset(&dst, new_row)
+                                          : col_offset(&dst, new_col);
+        }
+        for (int row = 0; row < h; row++) {
+                int new_col, new_row;
+                A2Transform_at(kind, w, h, 0, row, &new_col, &new_row);
+                plan->src_row[row] = row_offset(&src, row);
+                plan->dst_row[row] = swap ? col_offset(&dst, new_col)
+                                          : row_offset(&dst, new_row);
+        }
+        return plan;
+}
+
+void A2Plan_free(T *plan)
+{
+        assert(plan != NULL && *plan != NULL);
+        free((*plan)->src_col);     /* the start of all four tables */
+        free(*plan);
+        *plan = NULL;
+}
+
+bool A2Plan_fits(T plan, A2Layout src, A2Layout dst)
+{
+        assert(plan != NULL);
+        return src.width == plan->width && src.height == plan->height
+               && src.size == plan->size && src.blocksize == plan->src_bs
+               && dst.width == plan->dst_width
+               && dst.height == plan->dst_height
+               && dst.size == plan->size && dst.blocksize == plan->dst_bs;
+}
+
+/* copies source cell (col, row); size is a constant where inlined */
+#define COPY(col, row)                                                    \
+        memcpy(dst_base + dst_col[col] + dst_row[row],                    \
+               src_base + src_col[col] + src_row[row], size)
+
+/********** execute ********
+ *
+ * Copies source rows row_lo ... row_hi - 1 in the plan's order
+ *
+ * Notes:
+ *      Inlined for each cell size, and called with size a constant for
+ *      a Pnm_rgb or a packed pixel, so each cell is a few plain moves.
+ *      Block-major walks the source a tile at a time, which for a
+ *      blocked array is a block at a time, as the kernels of
+ *      a2transform.c do.
+ ************************/
+static inline void execute(T plan, char *src_base, char *dst_base,
+                           int row_lo, int row_hi, int size)
+{
+        /* in locals, as the stores through dst_base could otherwise be
+         * taken to change them */
+        const size_t *const src_col = plan->src_col;
+        const size_t *const src_row = plan->src_row;
+        const size_t *const dst_col = plan->dst_col;
+        const size_t *const dst_row = plan->dst_row;
+        const int w = plan->width;
+
+        switch (plan->order) {
+        case A2_ROW_MAJOR:
+                for (int row = row_lo; row < row_hi; row++) {
+                        for (int col = 0; col < w; col++) {
+                                COPY(col, row);
+                        }
+                }
+                break;
+        case A2_COL_MAJOR:
+                for (int col = 0; col < w; col++) {
+                        for (int row = row_lo; row < row_hi; row++) {
+                                COPY(col, row);
+                        }
+                }
+                break;
+        case A2_BLOCK_MAJOR: {
+                int tile = plan->tile;
+                for (int row0 = row_lo; row0 < row_hi; row0 += tile) {
+                        int row1 = row0 + tile < row_hi ? row0 + tile
+                                                        : row_hi;
+                        for (int col0 = 0; col0 < w; col0 += tile) {
+                                int col1 = col0 + tile < w ? col0 + tile : w;
+                                for (int row = row0; row < row1; row++) {
+                                        for (int col = col0; col < col1;
+                                             col++) {
+                                                COPY(col, row);
+                                        }
+                                }
+                        }
+                }
+                break;
+        }
+        }
+}
+
+#undef COPY
+
+void A2Plan_execute(T plan, A2Layout src, A2Layout dst)
+{
+        assert(plan != NULL);
+        A2Plan_execute_rows(plan, src, dst, 0, src.height);
+}
+
+void A2Plan_execute_rows(T plan, A2Layout src, A2Layout dst, int row_lo,
+                         int row_hi)
+{
+        assert(plan != NULL && A2Plan_fits(plan, src, dst));
+        assert(0 <= row_lo && row_lo <= row_hi && row_hi <= src.height);
+
+        if (plan->src_col == NULL) {
+                A2Transform_traverse_rows(plan->kind, plan->order, src, dst,
+                                          row_lo, row_hi);
+        } else if (plan->size == RGB_SIZE) {
+                execute(plan, src.base, dst.base, row_lo, row_hi, RGB_SIZE);
+        } else if (plan->size == PACKED_SIZE) {
+                execute(plan, src.base, dst.base, row_lo, row_hi,
+                        PACKED_SIZE);
+        } else {
+                execute(plan, src.base, dst.base, row_lo, row_hi, plan->size);
+        }
+}
+
+#undef T
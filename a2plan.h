@@ -0,0 +1,61 @@
+/**************************************************************
+ *
+ *                     a2plan.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to transform plans.  When every frame has the same
+ *     size, where each cell goes is the same every time, so a plan
+ *     works it out once: for one transform, traversal and pair of
+ *     array shapes it keeps the byte offset of every source column and
+ *     row, in the source and in the destination.  Executing the plan
+ *     on a frame is then a table lookup and an add per cell, with no
+ *     new_col/new_row arithmetic, no divisions by the block size and
+ *     no per-cell checks.
+ *
+ **************************************************************/
+
+#ifndef A2PLAN_INCLUDED
+#define A2PLAN_INCLUDED
+
+#include <stdbool.h>
+
+#include "a2transform.h"
+
+#define T A2Plan_T
+typedef struct T *T;
+
+/*
+ * a plan for transforming arrays shaped like src into arrays shaped
+ * like dst, visiting the source in the given order.  Only the shapes
+ * (dimensions, cell size and block size) are kept, not the storage.
+ * dst must have the dimensions A2Transform_dims gives and the same
+ * cell size as src (checked runtime error)
+ */
+extern T A2Plan_new(A2Transform_T kind, A2Traversal_T order, A2Layout src,
+                    A2Layout dst);
+
+extern void A2Plan_free(T *plan);
+
+/* true if src and dst have the shapes plan was made for */
+extern bool A2Plan_fits(T plan, A2Layout src, A2Layout dst);
+
+/*
+ * same result as A2Transform_traverse with the plan's transform and
+ * order.  src and dst must fit the plan (checked runtime error, once
+ * per call)
+ */
+extern void A2Plan_execute(T plan, A2Layout src, A2Layout dst);
+
+/*
+ * A2Plan_execute for source rows row_lo ... row_hi - 1 only; as with
+ * A2Transform_traverse_rows, calls for disjoint row ranges write
+ * disjoint cells and can run in parallel
+ */
+extern void A2Plan_execute_rows(T plan, A2Layout src, A2Layout dst,
+                                int row_lo, int row_hi);
+
+#undef T
+#endif
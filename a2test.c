@@ -1,9 +1,21 @@
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include "assert.h"
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2transform.h"
+#include "a2affine.h"
+#include "a2plan.h"
+#include "a2watch.h"
+#include "a2trace.h"
+#include "cachesim.h"
+#include "pnm.h"
+#include "ppmstream.h"
 
 
 #define W 13
@@ -34,6 +46,40 @@ static void small_check_and_increment(void *elem, void *cl)
         *counter += 1;   // NOT *counter++!
 }
 
+/* what a span callback needs to check its runs against methods->at */
+struct span_closure {
+        A2 array;
+        int cells;
+};
+
+static void check_span(void *elem, int count, int col, int row, void *cl)
+{
+        struct span_closure *span_cl = cl;
+        char *p = elem;
+        int size = methods->size(span_cl->array);
+
+        assert(count > 0);
+        for (int k = 0; k < count; k++) {
+                assert(p + k * size == methods->at(span_cl->array, 
+                                                   col + k, row));
+        }
+        span_cl->cells += count;
+}
+
+static void check_spans(A2 array)
+{
+        struct span_closure span_cl = { array, 0 };
+        if (methods->map_spans_row_major) {
+                methods->map_spans_row_major(array, check_span, &span_cl);
+                assert(span_cl.cells == W * H);
+        }
+        span_cl.cells = 0;
+        if (methods->map_spans_block_major) {
+                methods->map_spans_block_major(array, check_span, &span_cl);
+                assert(span_cl.cells == W * H);
+        }
+}
+
 static void double_row_major_plus()
 {
         /* store increasing integers in row-major order */
@@ -63,6 +109,7 @@ static void double_row_major_plus()
                                              small_check_and_increment,
                                              &counter);
         }
+        check_spans(array);
         methods->free(&array);
 }
 
@@ -120,6 +167,762 @@ static inline void copy_unsigned(A2Methods_T methods, A2 a,
         *p = n;
 }
 
+/* every native transform must agree with A2Transform_at cell for cell */
+static void check_transform(A2 array, A2Methods_transformfun *transform,
+                            A2Transform_T kind)
+{
+        if (transform == NULL) {
+                return;
+        }
+        A2 result = transform(array);
+        int new_width, new_height;
+        A2Transform_dims(kind, W, H, &new_width, &new_height);
+        assert(methods->width(result) == new_width);
+        assert(methods->height(result) == new_height);
+
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        int new_i, new_j;
+                        A2Transform_at(kind, W, H, i, j, &new_i, &new_j);
+                        check(result, new_i, new_j, 1000 * i + j);
+                }
+        }
+
+        /* every generated kernel must build the same array */
+        A2Layout src, dst;
+        A2 copy = methods->new_with_blocksize(new_width, new_height,
+                                              sizeof(unsigned),
+                                              methods->blocksize(array));
+        assert(A2Layout_of(methods, array, &src));
+        assert(A2Layout_of(methods, copy, &dst));
+        for (int order = A2_ROW_MAJOR; order <= A2_BLOCK_MAJOR; order++) {
+                A2Transform_traverse(kind, order, src, dst);
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                unsigned *p = methods->at(result, i, j);
+                                check(copy, i, j, *p);
+                        }
+                }
+
+                /* and so must uneven bands of rows, done separately */
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                copy_unsigned(methods, copy, i, j, ~0u);
+                        }
+                }
+                A2Transform_traverse_rows(kind, order, src, dst, 0, 5);
+                A2Transform_traverse_rows(kind, order, src, dst, 5, 9);
+                A2Transform_traverse_rows(kind, order, src, dst, 9, 9);
+                A2Transform_traverse_rows(kind, order, src, dst, 9, H);
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                unsigned *p = methods->at(result, i, j);
+                                check(copy, i, j, *p);
+                        }
+                }
+
+                /* and so must a plan, whole and in bands */
+                A2Plan_T plan = A2Plan_new(kind, order, src, dst);
+                assert(A2Plan_fits(plan, src, dst));
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                copy_unsigned(methods, copy, i, j, ~0u);
+                        }
+                }
+                A2Plan_execute(plan, src, dst);
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                unsigned *p = methods->at(result, i, j);
+                                check(copy, i, j, *p);
+                        }
+                }
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                copy_unsigned(methods, copy, i, j, ~0u);
+                        }
+                }
+                A2Plan_execute_rows(plan, src, dst, 0, 5);
+                A2Plan_execute_rows(plan, src, dst, 5, H);
+                for (int i = 0; i < new_width; i++) {
+                        for (int j = 0; j < new_height; j++) {
+                                unsigned *p = methods->at(result, i, j);
+                                check(copy, i, j, *p);
+                        }
+                }
+                A2Plan_free(&plan);
+        }
+        methods->free(&copy);
+        methods->free(&result);
+}
+
+static void check_transforms(A2 array)
+{
+        check_transform(array, methods->rotate90, A2_ROTATE_90);
+        check_transform(array, methods->rotate180, A2_ROTATE_180);
+        check_transform(array, methods->rotate270, A2_ROTATE_270);
+        check_transform(array, methods->flip_h, A2_FLIP_HORIZONTAL);
+        check_transform(array, methods->flip_v, A2_FLIP_VERTICAL);
+        check_transform(array, methods->transpose, A2_TRANSPOSE);
+        check_transform(array, methods->transverse, A2_TRANSVERSE);
+}
+
+/* a cell the size of a Pnm_rgb, so quarter turns use the 4 x 4 engine
+ * and flips and half turns use the row reversal engine */
+struct triple {
+        unsigned a, b, c;
+};
+
+static void check_triple_rotation(A2 array, A2Methods_transformfun *rotate,
+                                  A2Transform_T kind)
+{
+        int w = methods->width(array);
+        int h = methods->height(array);
+        A2 result = rotate(array);
+
+        for (int i = 0; i < w; i++) {
+                for (int j = 0; j < h; j++) {
+                        int new_i, new_j;
+                        A2Transform_at(kind, w, h, i, j, &new_i, &new_j);
+                        struct triple *p = methods->at(result, new_i, new_j);
+                        assert(p->a == (unsigned)i && p->b == (unsigned)j);
+                        assert(p->c == (unsigned)(i * j));
+                }
+        }
+        methods->free(&result);
+}
+
+static void check_triple_rotations(int blocksize)
+{
+        A2 array = methods->new_with_blocksize(3 * W, 2 * H,
+                                               sizeof(struct triple),
+                                               blocksize);
+        for (int i = 0; i < 3 * W; i++) {
+                for (int j = 0; j < 2 * H; j++) {
+                        struct triple *p = methods->at(array, i, j);
+                        p->a = i;
+                        p->b = j;
+                        p->c = i * j;
+                }
+        }
+        if (methods->rotate90) {
+                check_triple_rotation(array, methods->rotate90, A2_ROTATE_90);
+        }
+        if (methods->rotate270) {
+                check_triple_rotation(array, methods->rotate270, 
+                                      A2_ROTATE_270);
+        }
+        if (methods->rotate180) {
+                check_triple_rotation(array, methods->rotate180, 
+                                      A2_ROTATE_180);
+        }
+        if (methods->flip_h) {
+                check_triple_rotation(array, methods->flip_h, 
+                                      A2_FLIP_HORIZONTAL);
+        }
+        if (methods->transpose) {
+                check_triple_rotation(array, methods->transpose, 
+                                      A2_TRANSPOSE);
+        }
+        if (methods->transverse) {
+                check_triple_rotation(array, methods->transverse, 
+                                      A2_TRANSVERSE);
+        }
+        methods->free(&array);
+}
+
+/* in-place transforms must leave the same cells where a copy would */
+static void check_in_place(A2Transform_T kind, int blocksize)
+{
+        A2 array = methods->new_with_blocksize(W, H, sizeof(unsigned),
+                                               blocksize);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+
+        A2Layout layout;
+        assert(A2Transform_in_place_ok(kind, W, H));
+        assert(A2Layout_of(methods, array, &layout));
+        A2Transform_in_place(kind, layout);
+
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        int new_i, new_j;
+                        A2Transform_at(kind, W, H, i, j, &new_i, &new_j);
+                        check(array, new_i, new_j, 1000 * i + j);
+                }
+        }
+        methods->free(&array);
+}
+
+/* quarter turns in place: 4-cycles when square, cycle-following when not */
+static void check_quarter_in_place(A2Transform_T kind, int w, int h,
+                                   int blocksize)
+{
+        A2 array = methods->new_with_blocksize(w, h, sizeof(unsigned),
+                                               blocksize);
+        for (int i = 0; i < w; i++) {
+                for (int j = 0; j < h; j++) {
+                        copy_unsigned(methods, array, i, j, 1000 * i + j);
+                }
+        }
+
+        A2Layout layout, result;
+        assert(A2Layout_of(methods, array, &layout));
+        if (A2Transform_in_place_ok(kind, w, h)) {
+                A2Transform_in_place(kind, layout);
+                result = layout;
+        } else {
+                result = A2Transform_in_place_cycles(kind, layout);
+        }
+
+        for (int i = 0; i < w; i++) {
+                for (int j = 0; j < h; j++) {
+                        int new_i, new_j;
+                        A2Transform_at(kind, w, h, i, j, &new_i, &new_j);
+                        unsigned *p = A2Layout_at(&result, new_i, new_j);
+                        assert(*p == (unsigned)(1000 * i + j));
+                }
+        }
+        methods->free(&array);
+}
+
+static void check_in_places(int blocksize)
+{
+        check_quarter_in_place(A2_ROTATE_90, W, W, blocksize);
+        check_quarter_in_place(A2_ROTATE_270, H, H, blocksize);
+        check_quarter_in_place(A2_TRANSPOSE, W, W, blocksize);
+        check_quarter_in_place(A2_ROTATE_90, W, H, blocksize);
+        check_quarter_in_place(A2_ROTATE_270, W, H, blocksize);
+        check_quarter_in_place(A2_TRANSPOSE, H, W, blocksize);
+        check_quarter_in_place(A2_TRANSVERSE, H, H, blocksize);
+        check_quarter_in_place(A2_TRANSVERSE, W, H, blocksize);
+        check_in_place(A2_ROTATE_180, blocksize);
+        check_in_place(A2_FLIP_HORIZONTAL, blocksize);
+        check_in_place(A2_FLIP_VERTICAL, blocksize);
+}
+
+/* composing two transforms moves every cell where doing them in turn does */
+static void check_compositions(void)
+{
+        for (A2Transform_T a = A2_ROTATE_0; a <= A2_TRANSVERSE; a++) {
+                for (A2Transform_T b = A2_ROTATE_0; b <= A2_TRANSVERSE; b++) {
+                        A2Transform_T ab = A2Transform_compose(a, b);
+                        int mid_w, mid_h;
+                        A2Transform_dims(a, W, H, &mid_w, &mid_h);
+                        for (int i = 0; i < W; i++) {
+                                for (int j = 0; j < H; j++) {
+                                        int i1, j1, i2, j2, i3, j3;
+                                        A2Transform_at(a, W, H, i, j, 
+                                                       &i1, &j1);
+                                        A2Transform_at(b, mid_w, mid_h, 
+                                                       i1, j1, &i2, &j2);
+                                        A2Transform_at(ab, W, H, i, j, 
+                                                       &i3, &j3);
+                                        assert(i2 == i3 && j2 == j3);
+                                }
+                        }
+                }
+        }
+}
+
+/* warping by the matrix of one of the eight transforms lands every cell
+ * exactly where the transform does, whichever the sampling */
+static void check_warp(A2Transform_T kind, A2Sampling_T sampling,
+                       int blocksize)
+{
+        A2 array = methods->new_with_blocksize(W, H, sizeof(struct triple),
+                                               blocksize);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        struct triple *p = methods->at(array, i, j);
+                        p->a = i;
+                        p->b = j;
+                        p->c = 65535 - i * j;
+                }
+        }
+
+        A2Affine m = A2Affine_of(kind);
+        int new_width, new_height, kind_width, kind_height;
+        A2Affine_dims(m, W, H, &new_width, &new_height);
+        A2Transform_dims(kind, W, H, &kind_width, &kind_height);
+        assert(new_width == kind_width && new_height == kind_height);
+        A2 result = methods->new_with_blocksize(new_width, new_height,
+                                                sizeof(struct triple),
+                                                blocksize);
+        A2Layout src, dst;
+        assert(A2Layout_of(methods, array, &src));
+        assert(A2Layout_of(methods, result, &dst));
+        A2Affine_apply(m, sampling, src, dst);
+
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        int new_i, new_j;
+                        A2Transform_at(kind, W, H, i, j, &new_i, &new_j);
+                        struct triple *p = methods->at(result, new_i, new_j);
+                        assert(p->a == (unsigned)i && p->b == (unsigned)j);
+                        assert(p->c == (unsigned)(65535 - i * j));
+                }
+        }
+        methods->free(&result);
+        methods->free(&array);
+}
+
+/* a turned flat image stays flat where it lands, and black elsewhere */
+static void check_warp_flat(int blocksize)
+{
+        A2 array = methods->new_with_blocksize(W, H, sizeof(struct triple),
+                                               blocksize);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        struct triple *p = methods->at(array, i, j);
+                        p->a = 65535;
+                        p->b = 1000;
+                        p->c = 7;
+                }
+        }
+
+        A2Affine m = A2Affine_rotation(30);
+        int new_width, new_height;
+        A2Affine_dims(m, W, H, &new_width, &new_height);
+        assert(new_width > W && new_height > H);
+        A2 result = methods->new_with_blocksize(new_width, new_height,
+                                                sizeof(struct triple),
+                                                blocksize);
+        A2Layout src, dst;
+        assert(A2Layout_of(methods, array, &src));
+        assert(A2Layout_of(methods, result, &dst));
+        A2Affine_apply(m, A2_BILINEAR, src, dst);
+
+        int inside = 0;
+        for (int i = 0; i < new_width; i++) {
+                for (int j = 0; j < new_height; j++) {
+                        struct triple *p = methods->at(result, i, j);
+                        if (p->a == 0) {
+                                assert(p->b == 0 && p->c == 0);
+                        } else {
+                                assert(p->a == 65535 && p->b == 1000);
+                                assert(p->c == 7);
+                                inside++;
+                        }
+                }
+        }
+        /* a turn keeps the area, give or take the edge cells */
+        assert(inside > W * H - (W + H) && inside < W * H + (W + H));
+        methods->free(&result);
+        methods->free(&array);
+}
+
+static void check_warps(int blocksize)
+{
+        for (A2Transform_T kind = A2_ROTATE_0; kind <= A2_TRANSVERSE; 
+             kind++) {
+                check_warp(kind, A2_NEAREST, blocksize);
+                check_warp(kind, A2_BILINEAR, blocksize);
+        }
+        check_warp_flat(blocksize);
+}
+
+/* shrinking by factor averages each factor x factor block (smaller at 
+ * the edges) and lands it where the transform puts the reduced cell */
+static void check_reduce(A2Transform_T kind, int factor, int blocksize)
+{
+        A2 array = methods->new_with_blocksize(W, H, sizeof(struct triple),
+                                               blocksize);
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        struct triple *p = methods->at(array, i, j);
+                        p->a = 100 * i;
+                        p->b = 100 * j;
+                        p->c = i * j;
+                }
+        }
+
+        int w, h, new_width, new_height;
+        A2Transform_reduced_dims(factor, W, H, &w, &h);
+        A2Transform_dims(kind, w, h, &new_width, &new_height);
+        A2 result = methods->new_with_blocksize(new_width, new_height,
+                                                sizeof(struct triple),
+                                                blocksize);
+        A2Layout src, dst;
+        assert(A2Layout_of(methods, array, &src));
+        assert(A2Layout_of(methods, result, &dst));
+        A2Transform_reduce(kind, factor, src, dst);
+
+        for (int i = 0; i < w; i++) {
+                for (int j = 0; j < h; j++) {
+                        unsigned a = 0, b = 0, c = 0, n = 0;
+                        for (int x = i * factor; 
+                             x < W && x - i * factor < factor; x++) {
+                                for (int y = j * factor;
+                                     y < H && y - j * factor < factor; y++) {
+                                        a += 100 * x;
+                                        b += 100 * y;
+                                        c += x * y;
+                                        n++;
+                                }
+                        }
+                        int new_i, new_j;
+                        A2Transform_at(kind, w, h, i, j, &new_i, &new_j);
+                        struct triple *p = methods->at(result, new_i, new_j);
+                        assert(p->a == (a + n / 2) / n);
+                        assert(p->b == (b + n / 2) / n);
+                        assert(p->c == (c + n / 2) / n);
+                }
+        }
+        methods->free(&result);
+        methods->free(&array);
+}
+
+static void check_reduces(int blocksize)
+{
+        check_reduce(A2_ROTATE_0, 3, blocksize);
+        check_reduce(A2_ROTATE_90, 3, blocksize);
+        check_reduce(A2_FLIP_HORIZONTAL, 3, blocksize);
+        check_reduce(A2_TRANSVERSE, 3, blocksize);
+
+        /* a factor past either side, up to one that would overflow 
+         * rounding up, averages the whole image into one cell */
+        int w, h;
+        A2Transform_reduced_dims(INT_MAX, W, H, &w, &h);
+        assert(w == 1 && h == 1);
+        A2Transform_reduced_dims(INT_MAX, INT_MAX, INT_MAX - 1, &w, &h);
+        assert(w == 1 && h == 1);
+        check_reduce(A2_ROTATE_90, W > H ? W : H, blocksize);
+        check_reduce(A2_ROTATE_0, INT_MAX, blocksize);
+}
+
+/* what the observer of check_watch has seen */
+struct watch_count {
+        int at, map, bytes;
+};
+
+static void count_access(const void *address, int bytes, A2Watch_kind kind,
+                         int label, void *cl)
+{
+        struct watch_count *seen = cl;
+        (void)address;
+        assert(label == 7);
+        if (kind == A2WATCH_AT) {
+                seen->at++;
+        } else {
+                seen->map++;
+        }
+        seen->bytes += bytes;
+}
+
+static void count_cell(void *elem, void *cl)
+{
+        (void)elem;
+        *(int *)cl += 1;
+}
+
+/* the watched suite reports each at() and each cell a map passes, and
+ * otherwise behaves as the suite it wraps */
+static void check_watch(void)
+{
+        struct watch_count seen = { 0, 0, 0 };
+        A2Methods_T watched = A2Watch_methods(methods, count_access, &seen);
+        A2 array = watched->new_with_blocksize(W, H, sizeof(int), BS);
+        A2Watch_label(array, 7);
+        int counter = 1;
+        for (int j = 0; j < H; j++) {
+                for (int i = 0; i < W; i++) {
+                        *(int *)watched->at(array, i, j) = counter++;
+                }
+        }
+        assert(seen.at == W * H && seen.map == 0);
+
+        counter = 1;
+        if (watched->map_row_major) {
+                watched->map_row_major(array, check_and_increment, &counter);
+                assert(counter == W * H + 1 && seen.map == W * H);
+        }
+        seen.map = seen.bytes = 0;
+        int cells = 0;
+        watched->small_map_default(array, count_cell, &cells);
+        assert(cells == W * H && seen.map == W * H);
+        assert(seen.bytes == W * H * (int)sizeof(int));
+        assert(watched->rotate90 == NULL);
+        watched->free(&array);
+}
+
+/* a trace of a map and an at() reads back as the array's description,
+ * one map access per cell, and the at() at the address it returned */
+static void check_trace(void)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        A2Trace_T trace = A2Trace_new(fp);
+        A2Methods_T watched = A2Watch_methods(methods, A2Trace_observe, 
+                                              trace);
+        A2 array = methods->new_with_blocksize(W, H, sizeof(int), BS);
+        A2Trace_array(trace, 3, methods, array);
+        int cells = 0;
+        watched->small_map_default(array, count_cell, &cells);
+        watched->at(array, W - 1, 0);
+        A2Trace_free(&trace);
+
+        rewind(fp);
+        trace = A2Trace_reader(fp);
+        assert(trace != NULL);
+        A2Trace_record record;
+        assert(A2Trace_read(trace, &record) && record.is_array);
+        assert(record.label == 3 && record.width == W && record.height == H);
+        assert(record.address == (uintptr_t)methods->at(array, 0, 0));
+        int n = 0;
+        while (A2Trace_read(trace, &record)) {
+                assert(!record.is_array && record.label == 3);
+                assert(record.bytes == (int)sizeof(int));
+                n++;
+        }
+        assert(n == W * H + 1 && record.kind == A2WATCH_AT);
+        assert(record.address == (uintptr_t)methods->at(array, W - 1, 0));
+        A2Trace_free(&trace);
+        methods->free(&array);
+        fclose(fp);
+}
+
+/* the cache model on patterns whose misses are known */
+static void check_cachesim(void)
+{
+        Cachesim_level levels[] = {
+                { 4 * 64, 2, 64 },      /* 2 sets of 2 lines */
+                { 64 * 64, 4, 64 },
+        };
+        Cachesim_T sim = Cachesim_new(2, levels, 2);
+
+        /* a first pass over 16 lines misses each once at both levels */
+        static char buffer[64 * 18];
+        char *memory = (char *)(((uintptr_t)buffer + 63) & ~(uintptr_t)63);
+        for (int i = 0; i < 16; i++) {
+                Cachesim_access(sim, memory + 64 * i, 12, 0);
+        }
+        assert(Cachesim_lookups(sim, 0, 0) == 16);
+        assert(Cachesim_hits(sim, 0, 0) == 0);
+        assert(Cachesim_lookups(sim, 1, 0) == 16);
+        assert(Cachesim_hits(sim, 1, 0) == 0);
+
+        /* the second pass finds them all at level 1, but level 0, with
+         * room for 4, has lost them to the last lines of the pass */
+        for (int i = 0; i < 16; i++) {
+                Cachesim_access(sim, memory + 64 * i, 4, 0);
+        }
+        assert(Cachesim_hits(sim, 0, 0) == 0);
+        assert(Cachesim_hits(sim, 1, 0) == 16);
+
+        /* an access straddling two lines looks up both, for its own 
+         * stream */
+        Cachesim_access(sim, memory + 60, 8, 1);
+        assert(Cachesim_lookups(sim, 0, 1) == 2);
+        assert(Cachesim_lookups(sim, 0, 0) == 32);
+
+        /* lines 0 and 2 share a set; using 0 again keeps it over 2 when
+         * 4 comes in */
+        Cachesim_free(&sim);
+        sim = Cachesim_new(1, levels, 1);
+        Cachesim_access(sim, memory, 1, 0);
+        Cachesim_access(sim, memory + 128, 1, 0);
+        Cachesim_access(sim, memory, 1, 0);
+        Cachesim_access(sim, memory + 256, 1, 0);
+        Cachesim_access(sim, memory, 1, 0);
+        assert(Cachesim_hits(sim, 0, 0) == 2);
+        Cachesim_access(sim, memory + 128, 1, 0);
+        assert(Cachesim_hits(sim, 0, 0) == 2);
+        Cachesim_free(&sim);
+}
+
+/* a P3 is left for Pnm_ppmread, and its pixels still pack */
+static void check_plain_ppm(void)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        fputs("P3\n# plain\n3 2\n255\n"
+              "0 1 2  10 11 12  20 21 22\n"
+              "100 101 102  110 111 112  255 254 253\n", fp);
+        rewind(fp);
+
+        int magic = Ppmstream_read_magic(fp);
+        assert(magic == '3');
+        assert(Ppmstream_unread_magic(fp, magic) == fp);
+        assert(ftell(fp) == 0);
+        Pnm_ppm image = Pnm_ppmread(fp, uarray2_methods_plain);
+        assert(image->width == 3 && image->height == 2);
+
+        A2Methods_T blocked = uarray2_methods_blocked;
+        A2 packed = blocked->new_with_blocksize(3, 2, 
+                                                sizeof(struct Ppmstream_rgb8),
+                                                2);
+        Ppmstream_copy_pixels(image->methods, image->pixels, blocked, 
+                              packed);
+        for (int row = 0; row < 2; row++) {
+                for (int col = 0; col < 3; col++) {
+                        Pnm_rgb pixel = image->methods->at(image->pixels, 
+                                                           col, row);
+                        Ppmstream_rgb8 cell = blocked->at(packed, col, row);
+                        assert(cell->red == pixel->red);
+                        assert(cell->green == pixel->green);
+                        assert(cell->blue == pixel->blue);
+                        assert(cell->pad == 0);
+                }
+        }
+        Ppmstream_rgb8 last = blocked->at(packed, 2, 1);
+        assert(last->red == 255 && last->blue == 253);
+
+        blocked->free(&packed);
+        Pnm_ppmfree(&image);
+        fclose(fp);
+}
+
+/* a magic number read from a pipe, which cannot seek, is put back in a 
+ * copy; and one that is not a P is never read at all */
+static void check_unread_magic(void)
+{
+        int ends[2];
+        int made = pipe(ends);
+        assert(made == 0);
+        const char image[] = "P3\n1 1\n255\n7 8 9\n";
+        ssize_t written = write(ends[1], image, sizeof(image) - 1);
+        assert(written == (ssize_t)sizeof(image) - 1);
+        close(ends[1]);
+
+        FILE *fp = fdopen(ends[0], "rb");
+        assert(fp != NULL);
+        int magic = Ppmstream_read_magic(fp);
+        assert(magic == '3');
+        FILE *whole = Ppmstream_unread_magic(fp, magic);
+        assert(whole != fp);
+        char copy[sizeof(image)] = { 0 };
+        size_t n = fread(copy, 1, sizeof(copy), whole);
+        assert(n == sizeof(image) - 1);
+        assert(strcmp(copy, image) == 0);
+        fclose(whole);
+        fclose(fp);
+
+        fp = tmpfile();
+        assert(fp != NULL);
+        fputs("Q6", fp);
+        rewind(fp);
+        assert(Ppmstream_read_magic(fp) == 0);
+        assert(getc(fp) == 'Q');
+        fclose(fp);
+}
+
+/* the P6 image the crop checks read: CROP_W x CROP_H, each channel of 
+ * which says where its pixel is */
+#define CROP_W 11
+#define CROP_H 7
+
+static void write_crop_image(FILE *fp)
+{
+        fprintf(fp, "P6\n%d %d\n255\n", CROP_W, CROP_H);
+        for (int row = 0; row < CROP_H; row++) {
+                for (int col = 0; col < CROP_W; col++) {
+                        putc(col * 20, fp);
+                        putc(row * 30, fp);
+                        putc(col + row, fp);
+                }
+        }
+        fflush(fp);
+}
+
+/* a file holding the crop image: a pipe, which cannot seek, or a 
+ * temporary file */
+static FILE *crop_input(bool piped)
+{
+        if (!piped) {
+                FILE *fp = tmpfile();
+                assert(fp != NULL);
+                write_crop_image(fp);
+                rewind(fp);
+                return fp;
+        }
+        int ends[2];
+        int made = pipe(ends);
+        assert(made == 0);
+        FILE *out = fdopen(ends[1], "wb");
+        assert(out != NULL);
+        write_crop_image(out);
+        fclose(out);
+        FILE *fp = fdopen(ends[0], "rb");
+        assert(fp != NULL);
+        return fp;
+}
+
+/* reading the width x height crop at (x, y) of the crop image, then 
+ * transforming it by kind, gives the cells of the whole image read into
+ * an array, in their transformed places */
+static void check_crop(unsigned x, unsigned y, unsigned width, 
+                       unsigned height, A2Transform_T kind, bool piped)
+{
+        A2Methods_T plain = uarray2_methods_plain;
+        int size = sizeof(struct Ppmstream_rgb8);
+
+        FILE *fp = crop_input(false);
+        Ppmstream_T stream = Ppmstream_open(fp);
+        A2 whole = plain->new(CROP_W, CROP_H, size);
+        Ppmstream_read_pixels(stream, plain, whole);
+        Ppmstream_free(&stream);
+        fclose(fp);
+
+        fp = crop_input(piped);
+        stream = Ppmstream_open(fp);
+        Ppmstream_crop(stream, x, y, width, height);
+        assert(Ppmstream_width(stream) == width);
+        assert(Ppmstream_height(stream) == height);
+        A2 cropped = plain->new(width, height, size);
+        Ppmstream_read_pixels(stream, plain, cropped);
+        Ppmstream_free(&stream);
+        fclose(fp);
+
+        int new_width, new_height;
+        A2Transform_dims(kind, width, height, &new_width, &new_height);
+        A2 result = plain->new(new_width, new_height, size);
+        A2Layout src, dst;
+        assert(A2Layout_of(plain, cropped, &src));
+        assert(A2Layout_of(plain, result, &dst));
+        A2Transform_apply(kind, src, dst);
+
+        for (int col = 0; col < (int)width; col++) {
+                for (int row = 0; row < (int)height; row++) {
+                        int new_col, new_row;
+                        A2Transform_at(kind, width, height, col, row, 
+                                       &new_col, &new_row);
+                        Ppmstream_rgb8 got = plain->at(result, new_col, 
+                                                       new_row);
+                        Ppmstream_rgb8 want = plain->at(whole, x + col, 
+                                                        y + row);
+                        assert(got->red == want->red);
+                        assert(got->green == want->green);
+                        assert(got->blue == want->blue);
+                }
+        }
+        plain->free(&result);
+        plain->free(&cropped);
+        plain->free(&whole);
+}
+
+static void check_crops(void)
+{
+        /* inside every edge, from a file that seeks past the rows above
+         * and from a pipe that reads them */
+        check_crop(2, 3, 5, 2, A2_ROTATE_0, false);
+        check_crop(2, 3, 5, 2, A2_ROTATE_0, true);
+        /* to the right and bottom edges, and the whole image */
+        check_crop(4, 2, CROP_W - 4, CROP_H - 2, A2_ROTATE_0, false);
+        check_crop(4, 2, CROP_W - 4, CROP_H - 2, A2_ROTATE_0, true);
+        check_crop(0, 0, CROP_W, CROP_H, A2_ROTATE_0, false);
+        /* one pixel, a column and a row */
+        check_crop(CROP_W - 1, CROP_H - 1, 1, 1, A2_ROTATE_0, false);
+        check_crop(3, 0, 1, CROP_H, A2_ROTATE_0, true);
+        check_crop(0, 5, CROP_W, 1, A2_ROTATE_0, false);
+        /* then rotated */
+        check_crop(2, 3, 5, 2, A2_ROTATE_90, false);
+        check_crop(4, 2, CROP_W - 4, CROP_H - 2, A2_ROTATE_270, true);
+        check_crop(1, 1, 6, 4, A2_TRANSPOSE, false);
+}
+
 static void test_methods(A2Methods_T methods_under_test) 
 {
         methods = methods_under_test;
@@ -157,7 +960,18 @@ static void test_methods(A2Methods_T methods_under_test)
                         assert(*p == n);
                 }
         }
+        check_transforms(array);
+        check_triple_rotations(BS);
+        check_triple_rotations(BS + 3);
+        check_in_places(BS);
+        check_in_places(BS + 3);
+        check_warps(BS);
+        check_warps(BS + 3);
+        check_reduces(BS);
+        check_reduces(BS + 3);
         double_row_major_plus();
+        check_watch();
+        check_trace();
         methods->free(&array);
 }
 
@@ -165,8 +979,13 @@ int main(int argc, char *argv[])
 {
         assert(argc == 1);
         (void)argv;
+        check_compositions();
+        check_cachesim();
+        check_plain_ppm();
+        check_unread_magic();
+        check_crops();
         test_methods(uarray2_methods_plain);
-        /*  test_methods(uarray2_methods_blocked); */
+        test_methods(uarray2_methods_blocked);
         printf("Passed.\n");  /* only if we reach this point without
                                * assertion failure
                                */
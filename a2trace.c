@@ -0,0 +1,197 @@
+/**************************************************************
+ *
+ *                     a2trace.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the access trace.  Addresses are written as
+ *     the difference from the last one of the same array, which for
+ *     any traversal is a small number most of the time, so with the
+ *     varint encoding a typical access takes three or four bytes.
+ *     Writer and reader keep the same last addresses, one per label
+ *     and one for unlabelled arrays.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "a2trace.h"
+
+#define T A2Trace_T
+
+static const char magic[8] = "A2TRACE1";
+
+/* first byte of an array record; no access record starts with it, as
+ * label + 1 is at most A2TRACE_MAX_LABEL + 1 */
+#define ARRAY_RECORD 0x7f
+
+/* the top bit of an access record's first byte */
+#define KIND_BIT 0x80
+
+struct T {
+        FILE *fp;
+        bool writing;
+        uintptr_t last[A2TRACE_MAX_LABEL + 2];  /* by label + 1 */
+};
+
+T A2Trace_new(FILE *out)
+{
+        assert(out != NULL);
+        T trace = calloc(1, sizeof(*trace));
+        assert(trace != NULL);
+        trace->fp = out;
+        trace->writing = true;
+        fwrite(magic, 1, sizeof(magic), out);
+        return trace;
+}
+
+T A2Trace_reader(FILE *in)
+{
+        assert(in != NULL);
+        char header[sizeof(magic)];
+        if (fread(header, 1, sizeof(header), in) != sizeof(header)
+            || memcmp(header, magic, sizeof(magic)) != 0) {
+                return NULL;
+        }
+        T trace = calloc(1, sizeof(*trace));
+        assert(trace != NULL);
+        trace->fp = in;
+        return trace;
+}
+
+void A2Trace_free(T *trace)
+{
+        assert(trace != NULL && *trace != NULL);
+        if ((*trace)->writing) {
+                fflush((*trace)->fp);
+        }
+        free(*trace);
+        *trace = NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *                            Writing
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void put_varint(FILE *fp, uint64_t n)
+{
+        while (n >= 0x80) {
+                putc((int)(n & 0x7f) | 0x80, fp);
+                n >>= 7;
+        }
+        putc((int)n, fp);
+}
+
+static void put_le(FILE *fp, uint64_t n, int bytes)
+{
+        for (int i = 0; i < bytes; i++) {
+                putc((int)(n >> (8 * i)) & 0xff, fp);
+        }
+}
+
+void A2Trace_array(T trace, int label, A2Methods_T methods,
+                   A2Methods_UArray2 array)
+{
+        assert(trace != NULL && trace->writing);
+        assert(label >= 0 && label <= A2TRACE_MAX_LABEL);
+        A2Watch_label(array, label);
+
+        uintptr_t base = (uintptr_t)methods->at(array, 0, 0);
+        putc(ARRAY_RECORD, trace->fp);
+        putc(label, trace->fp);
+        put_le(trace->fp, base, 8);
+        put_le(trace->fp, methods->width(array), 4);
+        put_le(trace->fp, methods->height(array), 4);
+        put_le(trace->fp, methods->size(array), 4);
+        put_le(trace->fp, methods->blocksize(array), 4);
+        trace->last[label + 1] = base;
+}
+
+void A2Trace_observe(const void *address, int bytes, A2Watch_kind kind,
+                     int label, void *cl)
+{
+        T trace = cl;
+        assert(label <= A2TRACE_MAX_LABEL);
+        int slot = label + 1;
+        uintptr_t at = (uintptr_t)address;
+        int64_t delta = (int64_t)(at - trace->last[slot]);
+        uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+
+        putc((kind == A2WATCH_MAP ? KIND_BIT : 0) | slot, trace->fp);
+        put_varint(trace->fp, zigzag);
+        put_varint(trace->fp, bytes);
+        trace->last[slot] = at;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ *                            Reading
+ * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int get_byte(FILE *fp)
+{
+        int c = getc(fp);
+        assert(c != EOF);
+        return c;
+}
+
+static uint64_t get_varint(FILE *fp)
+{
+        uint64_t n = 0;
+        for (int shift = 0; ; shift += 7) {
+                assert(shift < 64);
+                int c = get_byte(fp);
+                n |= (uint64_t)(c & 0x7f) << shift;
+                if ((c & 0x80) == 0) {
+                        return n;
+                }
+        }
+}
+
+static uint64_t get_le(FILE *fp, int bytes)
+{
+        uint64_t n = 0;
+        for (int i = 0; i < bytes; i++) {
+                n |= (uint64_t)get_byte(fp) << (8 * i);
+        }
+        return n;
+}
+
+bool A2Trace_read(T trace, A2Trace_record *record)
+{
+        assert(trace != NULL && !trace->writing && record != NULL);
+        int first = getc(trace->fp);
+        if (first == EOF) {
+                return false;
+        }
+        memset(record, 0, sizeof(*record));
+
+        if (first == ARRAY_RECORD) {
+                record->is_array = true;
+                record->label = get_byte(trace->fp);
+                assert(record->label <= A2TRACE_MAX_LABEL);
+                record->address = get_le(trace->fp, 8);
+                record->width = get_le(trace->fp, 4);
+                record->height = get_le(trace->fp, 4);
+                record->size = get_le(trace->fp, 4);
+                record->blocksize = get_le(trace->fp, 4);
+                trace->last[record->label + 1] = record->address;
+                return true;
+        }
+
+        int slot = first & ~KIND_BIT;
+        assert(slot <= A2TRACE_MAX_LABEL + 1);
+        uint64_t zigzag = get_varint(trace->fp);
+        int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        record->label = slot - 1;
+        record->kind = (first & KIND_BIT) ? A2WATCH_MAP : A2WATCH_AT;
+        record->address = trace->last[slot] + (uintptr_t)delta;
+        record->bytes = get_varint(trace->fp);
+        trace->last[slot] = record->address;
+        return true;
+}
+
+#undef T
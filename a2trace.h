@@ -0,0 +1,87 @@
+/**************************************************************
+ *
+ *                     a2trace.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to the access trace: a compact binary record of every
+ *     element a watched methods suite (see a2watch.h) hands out, so the
+ *     access pattern of a traversal or of a callback can be studied
+ *     after the run.  Writing goes through stdio and each access is a
+ *     few bytes, so tracing costs little more than the watching.
+ *
+ *     A trace is the 8 bytes "A2TRACE1" followed by records.  An array
+ *     record describes a labelled array: the byte 0x7f, the label, then
+ *     the address of cell (0, 0) as 8 bytes and the width, height,
+ *     cell size and block size as 4 bytes each, all little-endian.  An
+ *     access record is a byte holding the kind in its top bit and
+ *     label + 1 in the rest (0 for an unlabelled array), then as
+ *     varints the zigzagged difference from the last address of the
+ *     same label and the number of bytes.
+ *
+ **************************************************************/
+
+#ifndef A2TRACE_INCLUDED
+#define A2TRACE_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+#include "a2watch.h"
+
+#define T A2Trace_T
+typedef struct T *T;
+
+/* labels a trace can tell apart: 0 to A2TRACE_MAX_LABEL */
+#define A2TRACE_MAX_LABEL 125
+
+/* starts a trace on out, which must be open for writing */
+extern T A2Trace_new(FILE *out);
+
+/* finishes a trace being written, and frees *trace either way; does
+ * not close its file */
+extern void A2Trace_free(T *trace);
+
+/*
+ * labels array (as A2Watch_label does) and records its shape, so a
+ * reader can tell which cell and block each address is.  methods is the
+ * suite array was made with, not the watched one, so that looking up
+ * its first cell is not itself traced
+ */
+extern void A2Trace_array(T trace, int label, A2Methods_T methods,
+                          A2Methods_UArray2 array);
+
+/* the observer to give A2Watch_methods, with the trace as its closure */
+extern A2Watch_observer A2Trace_observe;
+
+/* one record of a trace as read back */
+typedef struct A2Trace_record {
+        bool is_array;
+        int label;              /* -1 for an unlabelled access */
+        /* an access */
+        A2Watch_kind kind;
+        uintptr_t address;
+        int bytes;
+        /* an array */
+        int width, height, size, blocksize;
+} A2Trace_record;
+
+/*
+ * a trace to read from in, which is left just after the header; NULL
+ * if in does not start with one
+ */
+extern T A2Trace_reader(FILE *in);
+
+/*
+ * reads the next record into *record, with the address made whole
+ * again (for an array, the address of its cell (0, 0)); false at the
+ * end.  A truncated record is a checked runtime error
+ */
+extern bool A2Trace_read(T trace, A2Trace_record *record);
+
+#undef T
+#endif
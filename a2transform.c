@@ -0,0 +1,1311 @@
+/**************************************************************
+ *
+ *                     a2transform.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the transform engine.  The source is walked one
+ *     tile at a time (a block for blocked arrays, a TILE x TILE square
+ *     for plain ones) so that both the rows being read and the rows
+ *     being written stay in cache while the tile is copied.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "assert.h"
+#include "a2transform.h"
+
+/* side of a source tile for plain arrays, in cells */
+#define TILE 32
+
+/* bytes in a Pnm_rgb and in a packed pixel (see ppmstream.h), the cell
+ * sizes the rotation and reversal engines are built for */
+#define RGB_SIZE 12
+#define PACKED_SIZE 4
+
+/********** A2Layout_new ********
+ *
+ * Builds the raw view of an array's storage
+ *
+ * Parameters:
+ *      void *base: address of the cell at (0, 0)
+ *      int width, height: dimensions of the array
+ *      int size: bytes per cell
+ *      int blocksize: side of a block, 1 for a plain row-major array
+ *
+ * Return:
+ *      the layout
+ *
+ * Expects:
+ *      base must not be NULL, blocksize and size must be positive
+ ************************/
+A2Layout A2Layout_new(void *base, int width, int height, int size,
+                      int blocksize)
+{
+        assert(base != NULL);
+        assert(size > 0 && blocksize > 0);
+
+        A2Layout layout = { base, width, height, size, blocksize,
+                            (width + blocksize - 1) / blocksize };
+        return layout;
+}
+
+/********** A2Transform_dims ********
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      int width, height: dimensions of the source image
+ *      int *new_width, *new_height: set to the dimensions of the result
+ *
+ * Return:
+ *      None
+ ************************/
+void A2Transform_dims(A2Transform_T kind, int width, int height,
+                      int *new_width, int *new_height)
+{
+        if (kind == A2_ROTATE_90 || kind == A2_ROTATE_270
+            || kind == A2_TRANSPOSE || kind == A2_TRANSVERSE) {
+                *new_width = height;
+                *new_height = width;
+        } else {
+                *new_width = width;
+                *new_height = height;
+        }
+}
+
+/********** A2Transform_at ********
+ *
+ * Same formulas as the per-pixel callbacks in ppmtrans.c
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      int width, height: dimensions of the source image
+ *      int col, row: a cell of the source image
+ *      int *new_col, *new_row: set to where that cell goes
+ *
+ * Return:
+ *      None
+ ************************/
+void A2Transform_at(A2Transform_T kind, int width, int height,
+                    int col, int row, int *new_col, int *new_row)
+{
+        switch (kind) {
+        case A2_ROTATE_0:
+                *new_col = col;
+                *new_row = row;
+                break;
+        case A2_ROTATE_90:
+                *new_col = height - row - 1;
+                *new_row = col;
+                break;
+        case A2_ROTATE_180:
+                *new_col = width - col - 1;
+                *new_row = height - row - 1;
+                break;
+        case A2_ROTATE_270:
+                *new_col = row;
+                *new_row = width - col - 1;
+                break;
+        case A2_FLIP_HORIZONTAL:
+                *new_col = width - col - 1;
+                *new_row = row;
+                break;
+        case A2_FLIP_VERTICAL:
+                *new_col = col;
+                *new_row = height - row - 1;
+                break;
+        case A2_TRANSPOSE:
+                *new_col = row;
+                *new_row = col;
+                break;
+        case A2_TRANSVERSE:
+                *new_col = height - row - 1;
+                *new_row = width - col - 1;
+                break;
+        }
+}
+
+/********** A2Transform_compose ********
+ *
+ * Reduces "apply first, then second" to one of the eight transforms
+ *
+ * Parameters:
+ *      A2Transform_T first: the transform applied to the image
+ *      A2Transform_T second: the transform applied to first's result
+ *
+ * Return:
+ *      the transform that takes the image straight to the final result
+ *
+ * Notes:
+ *      Any chain of rotations and flips is a symmetry of the rectangle,
+ *      and there are only eight of them.  Rather than keep a table, the
+ *      pair is followed on a 2 x 3 image, which is small enough to be
+ *      cheap and lopsided enough that no two transforms move its cells
+ *      the same way.
+ ************************/
+A2Transform_T A2Transform_compose(A2Transform_T first, A2Transform_T second)
+{
+        enum { W = 2, H = 3 };
+        int mid_width, mid_height;
+        A2Transform_dims(first, W, H, &mid_width, &mid_height);
+
+        for (A2Transform_T kind = A2_ROTATE_0; kind <= A2_TRANSVERSE; 
+             kind++) {
+                bool same = true;
+                for (int row = 0; row < H && same; row++) {
+                        for (int col = 0; col < W && same; col++) {
+                                int c, r, want_col, want_row;
+                                A2Transform_at(first, W, H, col, row, &c, &r);
+                                A2Transform_at(second, mid_width, mid_height,
+                                               c, r, &want_col, &want_row);
+                                A2Transform_at(kind, W, H, col, row, &c, &r);
+                                same = c == want_col && r == want_row;
+                        }
+                }
+                if (same) {
+                        return kind;
+                }
+        }
+        assert(0);
+        return A2_ROTATE_0;
+}
+
+/* memcpy with a constant size becomes plain moves for a Pnm_rgb, and
+ * one move for a packed 4-byte pixel */
+static inline void copy_cell(void *dest, const void *src, int size)
+{
+        if (size == 12) {
+                memcpy(dest, src, 12);
+        } else if (size == 4) {
+                memcpy(dest, src, 4);
+        } else {
+                memcpy(dest, src, size);
+        }
+}
+
+/********** copy_tile ********
+ *
+ * Copies the source cells with col0 <= col < col1 and row0 <= row < row1
+ *
+ * Notes:
+ *      Moving one cell right in the source always moves the destination
+ *      cell by the same (dcol, drow), so A2Transform_at is only called
+ *      once per tile row.  The tile never crosses a source block, which
+ *      keeps each tile row one contiguous run of source cells.
+ ************************/
+static void copy_tile(A2Transform_T kind, const A2Layout *src,
+                      const A2Layout *dst, int col0, int row0,
+                      int col1, int row1)
+{
+        int dcol, drow, zero_col, zero_row;
+        A2Transform_at(kind, src->width, src->height, 1, 0, &dcol, &drow);
+        A2Transform_at(kind, src->width, src->height, 0, 0,
+                       &zero_col, &zero_row);
+        dcol -= zero_col;
+        drow -= zero_row;
+
+        int size = src->size;
+
+        for (int row = row0; row < row1; row++) {
+                char *from = A2Layout_at(src, col0, row);
+                int new_col, new_row;
+                A2Transform_at(kind, src->width, src->height, col0, row,
+                               &new_col, &new_row);
+
+                for (int col = col0; col < col1; col++) {
+                        copy_cell(A2Layout_at(dst, new_col, new_row),
+                                  from, size);
+                        from += size;
+                        new_col += dcol;
+                        new_row += drow;
+                }
+        }
+}
+
+/*****************************************************************
+ *           Quarter-turn and diagonal mirror engine
+ *****************************************************************/
+
+/*
+ * Four 12-byte cells are three 16-byte registers.  split_4_rgb breaks
+ * such a run into four registers holding one cell each (top 4 bytes
+ * cleared) and pack_4_rgb puts four of those back together, using only
+ * SSE2 byte shifts.  Loads and stores cover exactly the 48 bytes of a
+ * run, so nothing past a run is ever touched.
+ */
+#if defined(__SSE2__)
+static inline void split_4_rgb(const char *run, __m128i cell[4])
+{
+        const __m128i low3 = _mm_set_epi32(0, -1, -1, -1);
+        __m128i a = _mm_loadu_si128((const __m128i *)run);
+        __m128i b = _mm_loadu_si128((const __m128i *)(run + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(run + 32));
+
+        cell[0] = _mm_and_si128(a, low3);
+        cell[1] = _mm_and_si128(_mm_or_si128(_mm_srli_si128(a, 12),
+                                             _mm_slli_si128(b, 4)), low3);
+        cell[2] = _mm_and_si128(_mm_or_si128(_mm_srli_si128(b, 8),
+                                             _mm_slli_si128(c, 8)), low3);
+        cell[3] = _mm_srli_si128(c, 4);
+}
+
+static inline void pack_4_rgb(char *run, __m128i p0, __m128i p1, __m128i p2,
+                              __m128i p3)
+{
+        _mm_storeu_si128((__m128i *)run,
+                         _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+        _mm_storeu_si128((__m128i *)(run + 16),
+                         _mm_or_si128(_mm_srli_si128(p1, 4),
+                                      _mm_slli_si128(p2, 8)));
+        _mm_storeu_si128((__m128i *)(run + 32),
+                         _mm_or_si128(_mm_srli_si128(p2, 8),
+                                      _mm_slli_si128(p3, 4)));
+}
+#endif
+
+/********** transpose_4x4_rgb ********
+ *
+ * Transposes a 4 x 4 tile of 12-byte cells in registers
+ *
+ * Parameters:
+ *      char *src[4]: four runs of 4 cells each
+ *      char *dst[4]: four runs of 4 cells each; dst[k] receives cell k
+ *                    of src[0], src[1], src[2], src[3], in that order
+ *
+ * Notes:
+ *      Without SSE2 the cells are moved one at a time
+ ************************/
+static inline void transpose_4x4_rgb(char *const src[4], char *const dst[4])
+{
+#if defined(__SSE2__)
+        __m128i cell[4][4];     /* cell[i][k]: cell k of source run i */
+
+        for (int i = 0; i < 4; i++) {
+                split_4_rgb(src[i], cell[i]);
+        }
+        for (int k = 0; k < 4; k++) {
+                pack_4_rgb(dst[k], cell[0][k], cell[1][k], cell[2][k],
+                           cell[3][k]);
+        }
+#else
+        for (int k = 0; k < 4; k++) {
+                for (int i = 0; i < 4; i++) {
+                        memcpy(dst[k] + i * RGB_SIZE, src[i] + k * RGB_SIZE,
+                               RGB_SIZE);
+                }
+        }
+#endif
+}
+
+/********** transpose_4x4_packed ********
+ *
+ * transpose_4x4_rgb for 4-byte cells, where a run of 4 is one register
+ ************************/
+static inline void transpose_4x4_packed(char *const src[4],
+                                        char *const dst[4])
+{
+#if defined(__SSE2__)
+        __m128i r0 = _mm_loadu_si128((const __m128i *)src[0]);
+        __m128i r1 = _mm_loadu_si128((const __m128i *)src[1]);
+        __m128i r2 = _mm_loadu_si128((const __m128i *)src[2]);
+        __m128i r3 = _mm_loadu_si128((const __m128i *)src[3]);
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);   /* 00 10 01 11 */
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);   /* 20 30 21 31 */
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);   /* 02 12 03 13 */
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);   /* 22 32 23 33 */
+
+        _mm_storeu_si128((__m128i *)dst[0], _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)dst[1], _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128((__m128i *)dst[2], _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128((__m128i *)dst[3], _mm_unpackhi_epi64(t2, t3));
+#else
+        for (int k = 0; k < 4; k++) {
+                for (int i = 0; i < 4; i++) {
+                        memcpy(dst[k] + i * PACKED_SIZE,
+                               src[i] + k * PACKED_SIZE, PACKED_SIZE);
+                }
+        }
+#endif
+}
+
+/* true if the 4 cells from (col, row) rightwards sit next to each other */
+static inline bool run_of_4(const A2Layout *layout, int col)
+{
+        int bs = layout->blocksize;
+        return bs == 1 || col / bs == (col + 3) / bs;
+}
+
+/********** rotate_tile_rgb ********
+ *
+ * Rotates the source cells with col0 <= col < col1 and row0 <= row < row1
+ * by 90 or 270 degrees, or mirrors them across either diagonal, 4 x 4
+ * cells at a time
+ *
+ * Notes:
+ *      All four of these turn source rows into destination columns, so
+ *      each 4 x 4 group is one transpose_4x4_rgb.  They differ only in
+ *      which ends the runs are read from: when the new column counts
+ *      down from the source row (90 degrees, transverse) the source rows
+ *      are fed bottom-up, and when the new row counts down from the
+ *      source column (270 degrees, transverse) the destination rows are
+ *      filled bottom-up, so every destination run comes out left to
+ *      right.  Groups whose destination run would straddle two blocks,
+ *      and the ragged right and bottom edges, go through copy_tile.
+ *      Cells are 12-byte Pnm_rgbs or 4-byte packed pixels.
+ ************************/
+static void rotate_tile_rgb(A2Transform_T kind, const A2Layout *src,
+                            const A2Layout *dst, int col0, int row0,
+                            int col1, int row1)
+{
+        int w = src->width;
+        int h = src->height;
+        int col4 = col0 + (col1 - col0) / 4 * 4;
+        int row4 = row0 + (row1 - row0) / 4 * 4;
+        bool rows_up = kind == A2_ROTATE_90 || kind == A2_TRANSVERSE;
+        bool cols_up = kind == A2_ROTATE_270 || kind == A2_TRANSVERSE;
+        bool packed = src->size == PACKED_SIZE;
+
+        for (int row = row0; row < row4; row += 4) {
+                int dst_col = rows_up ? h - row - 4 : row;
+                bool fits = run_of_4(dst, dst_col);
+
+                for (int col = col0; col < col4; col += 4) {
+                        if (!fits || !run_of_4(src, col)) {
+                                copy_tile(kind, src, dst, col, row,
+                                          col + 4, row + 4);
+                                continue;
+                        }
+
+                        char *from[4], *to[4];
+                        for (int i = 0; i < 4; i++) {
+                                int src_row = rows_up ? row + 3 - i 
+                                                      : row + i;
+                                int dst_row = cols_up ? w - col - i - 1 
+                                                      : col + i;
+                                from[i] = A2Layout_at(src, col, src_row);
+                                to[i] = A2Layout_at(dst, dst_col, dst_row);
+                        }
+                        if (packed) {
+                                transpose_4x4_packed(from, to);
+                        } else {
+                                transpose_4x4_rgb(from, to);
+                        }
+                }
+        }
+
+        /* ragged right and bottom edges */
+        if (col4 < col1) {
+                copy_tile(kind, src, dst, col4, row0, col1, row1);
+        }
+        if (row4 < row1) {
+                copy_tile(kind, src, dst, col0, row4, col4, row1);
+        }
+}
+
+/*****************************************************************
+ *                     Row reversal engine
+ *****************************************************************/
+
+/********** reverse_run_rgb ********
+ *
+ * Copies n 12-byte cells from src to dst in reverse order
+ *
+ * Notes:
+ *      Four cells at a time are split into registers and packed back
+ *      in the opposite order; the last n % 4 cells are moved singly
+ ************************/
+static void reverse_run_rgb(char *dst, const char *src, int n)
+{
+        int i = 0;
+#if defined(__SSE2__)
+        for (; i + 4 <= n; i += 4) {
+                __m128i cell[4];
+                split_4_rgb(src + (size_t)(n - i - 4) * RGB_SIZE, cell);
+                pack_4_rgb(dst + (size_t)i * RGB_SIZE, cell[3], cell[2],
+                           cell[1], cell[0]);
+        }
+#endif
+        for (; i < n; i++) {
+                memcpy(dst + (size_t)i * RGB_SIZE,
+                       src + (size_t)(n - i - 1) * RGB_SIZE, RGB_SIZE);
+        }
+}
+
+/* reverse_run_rgb for 4-byte cells: a run of 4 is one register, reversed
+ * with a single shuffle */
+static void reverse_run_packed(char *dst, const char *src, int n)
+{
+        int i = 0;
+#if defined(__SSE2__)
+        for (; i + 4 <= n; i += 4) {
+                __m128i run = _mm_loadu_si128((const __m128i *)
+                                              (src + (size_t)(n - i - 4)
+                                                     * PACKED_SIZE));
+                _mm_storeu_si128((__m128i *)(dst + (size_t)i * PACKED_SIZE),
+                                 _mm_shuffle_epi32(run, 
+                                                   _MM_SHUFFLE(0, 1, 2, 3)));
+        }
+#endif
+        for (; i < n; i++) {
+                memcpy(dst + (size_t)i * PACKED_SIZE,
+                       src + (size_t)(n - i - 1) * PACKED_SIZE, PACKED_SIZE);
+        }
+}
+
+/* cells from col rightwards, up to 'limit', that sit next to each other */
+static inline int run_from(const A2Layout *layout, int col, int limit)
+{
+        int bs = layout->blocksize;
+        int n = bs == 1 ? limit - col : bs - col % bs;
+        return n < limit - col ? n : limit - col;
+}
+
+/* cells from col leftwards that sit next to each other */
+static inline int run_back_from(const A2Layout *layout, int col)
+{
+        int bs = layout->blocksize;
+        return bs == 1 ? col + 1 : col % bs + 1;
+}
+
+/********** reverse_row_rgb ********
+ *
+ * Writes source row src_row into destination row dst_row back to front
+ *
+ * Notes:
+ *      The row is cut into pieces that are contiguous in both arrays
+ *      (a whole row for plain arrays, at most a block row for blocked
+ *      ones) and each piece is reversed with reverse_run_rgb, or
+ *      reverse_run_packed for 4-byte cells
+ ************************/
+static void reverse_row_rgb(const A2Layout *src, const A2Layout *dst,
+                            int src_row, int dst_row)
+{
+        int w = src->width;
+        int col = 0;
+
+        while (col < w) {
+                int last = w - col - 1;     /* where cell col lands */
+                int n = run_from(src, col, w);
+                int m = run_back_from(dst, last);
+                if (m < n) {
+                        n = m;
+                }
+                char *to = A2Layout_at(dst, last - n + 1, dst_row);
+                char *from = A2Layout_at(src, col, src_row);
+                if (src->size == PACKED_SIZE) {
+                        reverse_run_packed(to, from, n);
+                } else {
+                        reverse_run_rgb(to, from, n);
+                }
+                col += n;
+        }
+}
+
+/* horizontal flips and half turns of pixel cells reverse whole rows */
+static inline bool use_reversal_engine(A2Transform_T kind, int size)
+{
+        return (kind == A2_FLIP_HORIZONTAL || kind == A2_ROTATE_180)
+               && (size == RGB_SIZE || size == PACKED_SIZE);
+}
+
+static void reverse_rows_rgb(A2Transform_T kind, const A2Layout *src,
+                             const A2Layout *dst, int row_lo, int row_hi)
+{
+        int h = src->height;
+        for (int row = row_lo; row < row_hi; row++) {
+                reverse_row_rgb(src, dst, row, 
+                                kind == A2_ROTATE_180 ? h - row - 1 : row);
+        }
+}
+
+/* the engine handles the transforms that swap the axes, for cells the
+ * size of a Pnm_rgb or of a packed pixel */
+static inline bool use_rotation_engine(A2Transform_T kind, int size)
+{
+        return (kind == A2_ROTATE_90 || kind == A2_ROTATE_270
+                || kind == A2_TRANSPOSE || kind == A2_TRANSVERSE)
+               && (size == RGB_SIZE || size == PACKED_SIZE);
+}
+
+/* A2Transform_apply for source rows row_lo ... row_hi - 1 only */
+static void apply_rows(A2Transform_T kind, const A2Layout *src,
+                       const A2Layout *dst, int row_lo, int row_hi)
+{
+        if (use_reversal_engine(kind, src->size)) {
+                reverse_rows_rgb(kind, src, dst, row_lo, row_hi);
+                return;
+        }
+
+        int tile = src->blocksize > 1 ? src->blocksize : TILE;
+        bool engine = use_rotation_engine(kind, src->size);
+
+        for (int row0 = row_lo; row0 < row_hi; row0 += tile) {
+                int row1 = row0 + tile < row_hi ? row0 + tile : row_hi;
+                for (int col0 = 0; col0 < src->width; col0 += tile) {
+                        int col1 = col0 + tile < src->width ? col0 + tile
+                                                            : src->width;
+                        if (engine) {
+                                rotate_tile_rgb(kind, src, dst, col0, row0,
+                                                col1, row1);
+                        } else {
+                                copy_tile(kind, src, dst, col0, row0,
+                                          col1, row1);
+                        }
+                }
+        }
+}
+
+/* dst must have the transformed dimensions and src's cell size */
+static void check_dims(A2Transform_T kind, const A2Layout *src,
+                       const A2Layout *dst)
+{
+        int new_width, new_height;
+        A2Transform_dims(kind, src->width, src->height, &new_width,
+                         &new_height);
+        assert(dst->width == new_width && dst->height == new_height);
+        assert(dst->size == src->size);
+        (void)new_width; (void)new_height;
+}
+
+/********** A2Transform_apply ********
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      A2Layout src: the image being transformed
+ *      A2Layout dst: where the result goes
+ *
+ * Return:
+ *      None
+ *
+ * Expects:
+ *      dst has the dimensions A2Transform_dims gives for src, and both
+ *      have the same cell size
+ *
+ * Notes:
+ *      For a blocked source each tile is one block, so the source side
+ *      is a block permutation and the destination side an intra-block
+ *      transform.  Plain sources use TILE x TILE squares.  Quarter turns
+ *      and diagonal mirrors of 12-byte and 4-byte cells transpose each
+ *      tile 4 x 4 cells at a time in registers rather than scattering
+ *      single cells, and flips and half turns of them reverse whole
+ *      rows in registers.
+ ************************/
+void A2Transform_apply(A2Transform_T kind, A2Layout src, A2Layout dst)
+{
+        check_dims(kind, &src, &dst);
+        apply_rows(kind, &src, &dst, 0, src.height);
+}
+
+/*****************************************************************
+ *                     In-place transforms
+ *****************************************************************/
+
+/* swaps n bytes at a and b through a small stack buffer */
+static void swap_bytes(char *a, char *b, size_t n)
+{
+        char tmp[256];
+        while (n > 0) {
+                size_t chunk = n < sizeof(tmp) ? n : sizeof(tmp);
+                memcpy(tmp, a, chunk);
+                memcpy(a, b, chunk);
+                memcpy(b, tmp, chunk);
+                a += chunk;
+                b += chunk;
+                n -= chunk;
+        }
+}
+
+static inline void swap_cells(char *a, char *b, int size)
+{
+        if (size == RGB_SIZE) {
+                char tmp[RGB_SIZE];
+                memcpy(tmp, a, RGB_SIZE);
+                memcpy(a, b, RGB_SIZE);
+                memcpy(b, tmp, RGB_SIZE);
+        } else {
+                swap_bytes(a, b, size);
+        }
+}
+
+/* mirrors cells [col0, col1) of row_a onto row_b: (c, row_a) swaps
+ * with (w - c - 1, row_b)
+ */
+static void swap_mirrored(const A2Layout *image, int row_a, int row_b,
+                          int col0, int col1)
+{
+        int w = image->width;
+        int size = image->size;
+
+        if (image->blocksize == 1) {
+                char *left = A2Layout_at(image, col0, row_a);
+                char *right = A2Layout_at(image, w - col0 - 1, row_b);
+                int col = col0;
+#if defined(__SSE2__)
+                /* four pairs at a time: each side reversed in registers
+                 * and stored on the other side */
+                for (; size == RGB_SIZE && col + 4 <= col1; col += 4) {
+                        __m128i l[4], r[4];
+                        char *right_run = right - 3 * RGB_SIZE;
+                        split_4_rgb(left, l);
+                        split_4_rgb(right_run, r);
+                        pack_4_rgb(left, r[3], r[2], r[1], r[0]);
+                        pack_4_rgb(right_run, l[3], l[2], l[1], l[0]);
+                        left += 4 * RGB_SIZE;
+                        right -= 4 * RGB_SIZE;
+                }
+#endif
+                for (; col < col1; col++) {
+                        swap_cells(left, right, size);
+                        left += size;
+                        right -= size;
+                }
+                return;
+        }
+        for (int col = col0; col < col1; col++) {
+                swap_cells(A2Layout_at(image, col, row_a),
+                           A2Layout_at(image, w - col - 1, row_b), size);
+        }
+}
+
+/* swaps two whole rows, one contiguous run (a block row) at a time */
+static void swap_rows(const A2Layout *image, int row_a, int row_b)
+{
+        int run = image->blocksize == 1 ? image->width : image->blocksize;
+
+        for (int col = 0; col < image->width; col += run) {
+                int count = image->width - col < run ? image->width - col
+                                                     : run;
+                swap_bytes(A2Layout_at(image, col, row_a),
+                           A2Layout_at(image, col, row_b),
+                           (size_t)count * image->size);
+        }
+}
+
+/* moves the four cells of a quarter-turn orbit one step along it */
+static void cycle_of_4(A2Transform_T kind, const A2Layout *image,
+                       int col, int row)
+{
+        int n = image->width;
+        char *cell[4];
+
+        for (int i = 0; i < 4; i++) {
+                cell[i] = A2Layout_at(image, col, row);
+                A2Transform_at(kind, n, n, col, row, &col, &row);
+        }
+
+        /* cell[0] passes through each slot in turn: a b c d -> d a b c */
+        for (int i = 1; i < 4; i++) {
+                swap_cells(cell[0], cell[i], image->size);
+        }
+}
+
+/********** A2Transform_in_place_ok ********
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      int width, height: dimensions of the image
+ *
+ * Return:
+ *      true if A2Transform_in_place can apply kind to such an image
+ *
+ * Notes:
+ *      Rotating by 0 or 180 and flipping send every cell to a cell of
+ *      the same array, and doing it twice gives the original back, so
+ *      the whole transform is a set of swaps of symmetric pairs.  A
+ *      square image keeps its shape under a quarter turn, transpose or
+ *      transverse too, and those break into orbits of at most four
+ *      cells.
+ ************************/
+bool A2Transform_in_place_ok(A2Transform_T kind, int width, int height)
+{
+        if (kind == A2_ROTATE_90 || kind == A2_ROTATE_270
+            || kind == A2_TRANSPOSE || kind == A2_TRANSVERSE) {
+                return width == height;
+        }
+        return true;
+}
+
+/********** A2Transform_in_place ********
+ *
+ * Applies kind to an image without a second image buffer
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      A2Layout image: the image, overwritten with the result
+ *
+ * Return:
+ *      None
+ *
+ * Expects:
+ *      A2Transform_in_place_ok(kind, width, height) (checked runtime
+ *      error)
+ *
+ * Notes:
+ *      Only a 256-byte stack buffer is used on top of the image
+ ************************/
+void A2Transform_in_place(A2Transform_T kind, A2Layout image)
+{
+        assert(A2Transform_in_place_ok(kind, image.width, image.height));
+
+        int w = image.width;
+        int h = image.height;
+
+        switch (kind) {
+        case A2_FLIP_HORIZONTAL:
+                for (int row = 0; row < h; row++) {
+                        swap_mirrored(&image, row, row, 0, w / 2);
+                }
+                break;
+        case A2_FLIP_VERTICAL:
+                for (int row = 0; row < h / 2; row++) {
+                        swap_rows(&image, row, h - row - 1);
+                }
+                break;
+        case A2_ROTATE_180:
+                for (int row = 0; row < h / 2; row++) {
+                        swap_mirrored(&image, row, h - row - 1, 0, w);
+                }
+                if (h % 2 == 1) {
+                        swap_mirrored(&image, h / 2, h / 2, 0, w / 2);
+                }
+                break;
+        case A2_ROTATE_90:
+        case A2_ROTATE_270:
+                /* one orbit starts at each cell of the top-left quarter
+                 * (rounded so the middle cell of an odd side is left) */
+                for (int row = 0; row < w / 2; row++) {
+                        for (int col = row; col < w - row - 1; col++) {
+                                cycle_of_4(kind, &image, col, row);
+                        }
+                }
+                break;
+        case A2_TRANSPOSE:
+                for (int row = 0; row < h; row++) {
+                        for (int col = row + 1; col < w; col++) {
+                                swap_cells(A2Layout_at(&image, col, row),
+                                           A2Layout_at(&image, row, col),
+                                           image.size);
+                        }
+                }
+                break;
+        case A2_TRANSVERSE:
+                for (int row = 0; row < h; row++) {
+                        for (int col = 0; col < w - row - 1; col++) {
+                                swap_cells(A2Layout_at(&image, col, row),
+                                           A2Layout_at(&image, w - row - 1,
+                                                       h - col - 1),
+                                           image.size);
+                        }
+                }
+                break;
+        default:
+                break;
+        }
+}
+
+/* number of cell slots behind a layout, padding included */
+static size_t slot_count(const A2Layout *layout)
+{
+        int bs = layout->blocksize;
+        size_t blocks_high = (layout->height + bs - 1) / bs;
+        return blocks_high * layout->blocks_wide * bs * bs;
+}
+
+/* the (col, row) a slot holds; false if the slot is block padding */
+static bool slot_cell(const A2Layout *layout, size_t slot, int *col, 
+                      int *row)
+{
+        int bs = layout->blocksize;
+        size_t block = slot / ((size_t)bs * bs);
+        int within = slot % ((size_t)bs * bs);
+
+        *row = (int)(block / layout->blocks_wide) * bs + within / bs;
+        *col = (int)(block % layout->blocks_wide) * bs + within % bs;
+        return *col < layout->width && *row < layout->height;
+}
+
+static size_t slot_of(const A2Layout *layout, int col, int row)
+{
+        return ((char *)A2Layout_at(layout, col, row) - layout->base)
+               / layout->size;
+}
+
+static A2Transform_T inverse(A2Transform_T kind)
+{
+        if (kind == A2_ROTATE_90) {
+                return A2_ROTATE_270;
+        } else if (kind == A2_ROTATE_270) {
+                return A2_ROTATE_90;
+        }
+        return kind;
+}
+
+/* slot of the source whose cell belongs in result slot 'slot' */
+static size_t source_slot(A2Transform_T back, const A2Layout *image,
+                          const A2Layout *result, size_t slot)
+{
+        int col, row;
+        bool used = slot_cell(result, slot, &col, &row);
+        assert(used);
+        A2Transform_at(back, result->width, result->height, col, row,
+                       &col, &row);
+        return slot_of(image, col, row);
+}
+
+#define VISIT(visited, slot) ((visited)[(slot) / 8] |= 1 << ((slot) % 8))
+#define VISITED(visited, slot) ((visited)[(slot) / 8] & (1 << ((slot) % 8)))
+
+/********** A2Transform_in_place_cycles ********
+ *
+ * Applies any transform inside the image's own storage, even when the
+ * result has a different shape
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      A2Layout image: the image; its storage is overwritten
+ *
+ * Return:
+ *      the layout of the result, which shares image's storage and
+ *      blocksize
+ *
+ * Notes:
+ *      A w x h and an h x w array of the same blocksize need the same
+ *      number of slots, so the result fits exactly.  Cells are moved by
+ *      following the permutation's cycles backwards from each slot, with
+ *      one bit per slot to remember which slots are done.  With blocks
+ *      that do not divide the image, some slots are padding in the
+ *      source but used in the result (or the reverse); those start and
+ *      end open chains, which are followed before the closed cycles.
+ *      Scratch space is the bitmap, 1/(8 * size) of the image.
+ ************************/
+A2Layout A2Transform_in_place_cycles(A2Transform_T kind, A2Layout image)
+{
+        int new_width, new_height;
+        A2Transform_dims(kind, image.width, image.height, &new_width,
+                         &new_height);
+        A2Layout result = A2Layout_new(image.base, new_width, new_height,
+                                       image.size, image.blocksize);
+        assert(slot_count(&result) == slot_count(&image));
+
+        size_t slots = slot_count(&image);
+        int size = image.size;
+        A2Transform_T back = inverse(kind);
+        unsigned char *visited = calloc(slots / 8 + 1, 1);
+        char *tmp = malloc(size);
+        assert(visited != NULL && tmp != NULL);
+
+        int col, row;
+
+        /* open chains: start where the result needs a slot the source
+         * left as padding, end at a source slot the result leaves empty */
+        for (size_t start = 0; start < slots; start++) {
+                if (!slot_cell(&result, start, &col, &row)
+                    || slot_cell(&image, start, &col, &row)) {
+                        continue;
+                }
+                size_t cur = start;
+                for (;;) {
+                        VISIT(visited, cur);
+                        size_t from = source_slot(back, &image, &result, cur);
+                        memcpy(image.base + cur * size,
+                               image.base + from * size, size);
+                        if (!slot_cell(&result, from, &col, &row)) {
+                                break;
+                        }
+                        cur = from;
+                }
+        }
+
+        /* closed cycles through the remaining used slots */
+        for (size_t start = 0; start < slots; start++) {
+                if (VISITED(visited, start)
+                    || !slot_cell(&result, start, &col, &row)) {
+                        continue;
+                }
+                memcpy(tmp, image.base + start * size, size);
+                size_t cur = start;
+                for (;;) {
+                        VISIT(visited, cur);
+                        size_t from = source_slot(back, &image, &result, cur);
+                        if (from == start) {
+                                memcpy(image.base + cur * size, tmp, size);
+                                break;
+                        }
+                        memcpy(image.base + cur * size,
+                               image.base + from * size, size);
+                        cur = from;
+                }
+        }
+
+        free(tmp);
+        free(visited);
+        return result;
+}
+
+/*****************************************************************
+ *                  Statically dispatched kernels
+ *****************************************************************/
+
+/*
+ * One kernel is generated for every (representation x transform x
+ * traversal) combination.  Each has the geometry in locals, the
+ * destination formula spelled out by the preprocessor, and no calls
+ * through function pointers, so the only work per pixel is the index
+ * arithmetic and the copy itself.
+ */
+
+/* where each transform sends (col, row), using the kernel's w and h */
+#define NEW_COL_ROTATE_0(col, row)          (col)
+#define NEW_ROW_ROTATE_0(col, row)          (row)
+#define NEW_COL_ROTATE_90(col, row)         (h - (row) - 1)
+#define NEW_ROW_ROTATE_90(col, row)         (col)
+#define NEW_COL_ROTATE_180(col, row)        (w - (col) - 1)
+#define NEW_ROW_ROTATE_180(col, row)        (h - (row) - 1)
+#define NEW_COL_ROTATE_270(col, row)        (row)
+#define NEW_ROW_ROTATE_270(col, row)        (w - (col) - 1)
+#define NEW_COL_FLIP_HORIZONTAL(col, row)   (w - (col) - 1)
+#define NEW_ROW_FLIP_HORIZONTAL(col, row)   (row)
+#define NEW_COL_FLIP_VERTICAL(col, row)     (col)
+#define NEW_ROW_FLIP_VERTICAL(col, row)     (h - (row) - 1)
+#define NEW_COL_TRANSPOSE(col, row)         (row)
+#define NEW_ROW_TRANSPOSE(col, row)         (col)
+#define NEW_COL_TRANSVERSE(col, row)        (h - (row) - 1)
+#define NEW_ROW_TRANSVERSE(col, row)        (w - (col) - 1)
+
+/* cell addresses; PREFIX picks the src or dst geometry locals */
+#define PLAIN_AT(PREFIX, col, row)                                        \
+        (PREFIX##base + ((size_t)(row) * PREFIX##width + (col)) * size)
+#define BLOCKED_AT(PREFIX, col, row)                                      \
+        (PREFIX##base + ((size_t)((row) / PREFIX##bs * PREFIX##bw         \
+                                  + (col) / PREFIX##bs)                   \
+                         * PREFIX##bs * PREFIX##bs                        \
+                         + ((row) % PREFIX##bs) * PREFIX##bs              \
+                         + (col) % PREFIX##bs) * size)
+
+/* the three traversals of source rows row_lo ... row_hi - 1 */
+#define ROW_LOOP(BODY)                                                    \
+        for (int row = row_lo; row < row_hi; row++) {                     \
+                for (int col = 0; col < w; col++) {                       \
+                        BODY;                                             \
+                }                                                         \
+        }
+#define COL_LOOP(BODY)                                                    \
+        for (int col = 0; col < w; col++) {                               \
+                for (int row = row_lo; row < row_hi; row++) {             \
+                        BODY;                                             \
+                }                                                         \
+        }
+#define BLOCK_LOOP(BODY)                                                  \
+        for (int row0 = row_lo; row0 < row_hi; row0 += tile) {            \
+                int row1 = row0 + tile < row_hi ? row0 + tile : row_hi;   \
+                for (int col0 = 0; col0 < w; col0 += tile) {              \
+                        int col1 = col0 + tile < w ? col0 + tile : w;     \
+                        for (int row = row0; row < row1; row++) {         \
+                                for (int col = col0; col < col1; col++) { \
+                                        BODY;                             \
+                                }                                         \
+                        }                                                 \
+                }                                                         \
+        }
+
+#define DEFINE_KERNEL(REP, TRAV, KIND)                                    \
+static void kernel_##REP##_##TRAV##_##KIND(const A2Layout *src,           \
+                                           const A2Layout *dst,           \
+                                           int row_lo, int row_hi)        \
+{                                                                         \
+        char *const src_base = src->base;                                 \
+        char *const dst_base = dst->base;                                 \
+        const int w = src->width, h = src->height, size = src->size;      \
+        const int src_width = w, dst_width = dst->width;                  \
+        const int src_bs = src->blocksize, src_bw = src->blocks_wide;     \
+        const int dst_bs = dst->blocksize, dst_bw = dst->blocks_wide;     \
+        const int tile = src_bs > 1 ? src_bs : TILE;                      \
+        (void)src_width; (void)dst_width; (void)src_bw; (void)dst_bw;     \
+        (void)dst_bs; (void)tile; (void)h;                                \
+                                                                          \
+        TRAV##_LOOP(copy_cell(REP##_AT(dst_,                              \
+                                       NEW_COL_##KIND(col, row),          \
+                                       NEW_ROW_##KIND(col, row)),         \
+                              REP##_AT(src_, col, row), size))            \
+}
+
+#define FOR_EACH_KIND(X, REP, TRAV)                                       \
+        X(REP, TRAV, ROTATE_0)                                            \
+        X(REP, TRAV, ROTATE_90)                                           \
+        X(REP, TRAV, ROTATE_180)                                          \
+        X(REP, TRAV, ROTATE_270)                                          \
+        X(REP, TRAV, FLIP_HORIZONTAL)                                     \
+        X(REP, TRAV, FLIP_VERTICAL)                                       \
+        X(REP, TRAV, TRANSPOSE)                                           \
+        X(REP, TRAV, TRANSVERSE)
+
+#define FOR_EACH_KERNEL(X)                                                \
+        FOR_EACH_KIND(X, PLAIN, ROW)                                      \
+        FOR_EACH_KIND(X, PLAIN, COL)                                      \
+        FOR_EACH_KIND(X, PLAIN, BLOCK)                                    \
+        FOR_EACH_KIND(X, BLOCKED, ROW)                                    \
+        FOR_EACH_KIND(X, BLOCKED, COL)                                    \
+        FOR_EACH_KIND(X, BLOCKED, BLOCK)
+
+FOR_EACH_KERNEL(DEFINE_KERNEL)
+
+typedef void kernelfun(const A2Layout *src, const A2Layout *dst, int row_lo,
+                       int row_hi);
+
+#define KERNEL_ENTRY(REP, TRAV, KIND)                                     \
+        [A2_##KIND] = kernel_##REP##_##TRAV##_##KIND,
+
+/* kernels[representation][traversal][kind], representation 0 = plain */
+static kernelfun *const kernels[2][3][A2_TRANSVERSE + 1] = {
+        {
+                [A2_ROW_MAJOR]   = { FOR_EACH_KIND(KERNEL_ENTRY, PLAIN, ROW) },
+                [A2_COL_MAJOR]   = { FOR_EACH_KIND(KERNEL_ENTRY, PLAIN, COL) },
+                [A2_BLOCK_MAJOR] = { FOR_EACH_KIND(KERNEL_ENTRY, PLAIN, BLOCK) },
+        },
+        {
+                [A2_ROW_MAJOR]   = { FOR_EACH_KIND(KERNEL_ENTRY, BLOCKED, ROW) },
+                [A2_COL_MAJOR]   = { FOR_EACH_KIND(KERNEL_ENTRY, BLOCKED, COL) },
+                [A2_BLOCK_MAJOR] = { FOR_EACH_KIND(KERNEL_ENTRY, BLOCKED, BLOCK) },
+        },
+};
+
+/********** A2Transform_traverse ********
+ *
+ * Same result as A2Transform_apply, but visits the source in the given
+ * order using the kernel generated for it
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      A2Traversal_T order: row-major, column-major or block-major
+ *      A2Layout src: the image being transformed
+ *      A2Layout dst: where the result goes
+ *
+ * Return:
+ *      None
+ *
+ * Expects:
+ *      same as A2Transform_apply; src and dst are either both plain
+ *      (blocksize 1) or both blocked
+ ************************/
+void A2Transform_traverse(A2Transform_T kind, A2Traversal_T order,
+                          A2Layout src, A2Layout dst)
+{
+        A2Transform_traverse_rows(kind, order, src, dst, 0, src.height);
+}
+
+/********** A2Transform_traverse_rows ********
+ *
+ * A2Transform_traverse restricted to some of the source rows
+ *
+ * Parameters:
+ *      A2Transform_T kind, A2Traversal_T order, A2Layout src, dst: as
+ *              for A2Transform_traverse
+ *      int row_lo, row_hi: only source rows row_lo ... row_hi - 1 are
+ *              copied
+ *
+ * Return:
+ *      None
+ *
+ * Expects:
+ *      0 <= row_lo <= row_hi <= src.height (checked runtime error)
+ *
+ * Notes:
+ *      The cells written are exactly the images of the rows given, so
+ *      calls for disjoint row ranges write disjoint cells of dst and can
+ *      run at the same time.  Ranges that start on a multiple of
+ *      A2Transform_grain keep every tile whole.
+ ************************/
+void A2Transform_traverse_rows(A2Transform_T kind, A2Traversal_T order,
+                               A2Layout src, A2Layout dst, int row_lo,
+                               int row_hi)
+{
+        check_dims(kind, &src, &dst);
+        assert((src.blocksize == 1) == (dst.blocksize == 1));
+        assert(0 <= row_lo && row_lo <= row_hi && row_hi <= src.height);
+
+        /* block-major quarter turns are exactly what the rotation engine
+         * does, and a row-major flip is exactly a reversal of each row */
+        if (order == A2_BLOCK_MAJOR && use_rotation_engine(kind, src.size)) {
+                apply_rows(kind, &src, &dst, row_lo, row_hi);
+                return;
+        }
+        if (order == A2_ROW_MAJOR && use_reversal_engine(kind, src.size)) {
+                reverse_rows_rgb(kind, &src, &dst, row_lo, row_hi);
+                return;
+        }
+
+        kernels[src.blocksize > 1][order][kind](&src, &dst, row_lo, row_hi);
+}
+
+/* true if A2Transform_traverse_rows hands kind and order to one of the
+ * engines above rather than to a generated kernel */
+bool A2Transform_has_engine(A2Transform_T kind, A2Traversal_T order,
+                            int size)
+{
+        return (order == A2_BLOCK_MAJOR && use_rotation_engine(kind, size))
+               || (order == A2_ROW_MAJOR && use_reversal_engine(kind, size));
+}
+
+/* rows per tile: the blocksize of a blocked layout, TILE for a plain one */
+int A2Transform_grain(A2Layout src)
+{
+        return src.blocksize > 1 ? src.blocksize : TILE;
+}
+
+/*****************************************************************
+ *                          Reduction
+ *****************************************************************/
+
+void A2Transform_reduced_dims(int factor, int width, int height,
+                              int *new_width, int *new_height)
+{
+        assert(factor >= 1);
+        assert(new_width != NULL && new_height != NULL);
+        /* rounding up as width + factor - 1 would overflow */
+        *new_width = width / factor + (width % factor != 0);
+        *new_height = height / factor + (height % factor != 0);
+}
+
+/* adds the channels of every cell of source row 'row' to the sums of
+ * the reduced cell its column falls in, a contiguous run at a time */
+static void sum_row_rgb(const A2Layout *src, int row, int factor,
+                        uint64_t *sums)
+{
+        int w = src->width;
+        int col = 0;
+
+        while (col < w) {
+                int n = run_from(src, col, w);
+                const char *cell = A2Layout_at(src, col, row);
+                uint64_t *sum = sums + (size_t)(col / factor) * 3;
+                int phase = col % factor;
+
+                for (int i = 0; i < n; i++, cell += RGB_SIZE) {
+                        unsigned channels[3];
+                        memcpy(channels, cell, RGB_SIZE);
+                        sum[0] += channels[0];
+                        sum[1] += channels[1];
+                        sum[2] += channels[2];
+                        if (++phase == factor) {
+                                phase = 0;
+                                sum += 3;
+                        }
+                }
+                col += n;
+        }
+}
+
+/********** A2Transform_reduce ********
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      int factor: how many source cells a side make one reduced cell
+ *      A2Layout src: the full-size image
+ *      A2Layout dst: where the reduced, transformed image goes
+ *
+ * Return:
+ *      None
+ *
+ * Expects:
+ *      factor >= 1, Pnm_rgb-sized cells, and dst of the dimensions
+ *      A2Transform_dims gives for the reduced image
+ *
+ * Notes:
+ *      The source is read a band of factor rows at a time, each row in
+ *      contiguous runs, into one row of 64-bit sums; each finished band
+ *      is one reduced row, which is rounded and written straight to
+ *      its transformed place.  Nothing the size of the source is ever
+ *      allocated.  A factor past the longer side of src is the same as
+ *      that side, one cell holding the average of the whole image, and
+ *      is clamped to it so that no block arithmetic can overflow.
+ ************************/
+void A2Transform_reduce(A2Transform_T kind, int factor, A2Layout src,
+                        A2Layout dst)
+{
+        int w, h, new_width, new_height;
+
+        assert(src.size == RGB_SIZE && dst.size == RGB_SIZE);
+        assert(factor >= 1);
+        int longer = src.width > src.height ? src.width : src.height;
+        if (factor > longer) {
+                factor = longer;
+        }
+        A2Transform_reduced_dims(factor, src.width, src.height, &w, &h);
+        A2Transform_dims(kind, w, h, &new_width, &new_height);
+        assert(dst.width == new_width && dst.height == new_height);
+
+        uint64_t *sums = calloc((size_t)w * 3, sizeof(*sums));
+        assert(sums != NULL);
+
+        for (int row = 0; row < h; row++) {
+                int lo = row * factor;
+                int hi = factor < src.height - lo ? lo + factor 
+                                                  : src.height;
+                for (int r = lo; r < hi; r++) {
+                        sum_row_rgb(&src, r, factor, sums);
+                }
+
+                for (int col = 0; col < w; col++) {
+                        int cols = src.width - col * factor;
+                        uint64_t count = (uint64_t)(hi - lo)
+                                         * (cols < factor ? cols : factor);
+                        uint64_t *sum = sums + (size_t)col * 3;
+                        unsigned average[3];
+                        for (int i = 0; i < 3; i++) {
+                                average[i] = (sum[i] + count / 2) / count;
+                                sum[i] = 0;
+                        }
+
+                        int new_col, new_row;
+                        A2Transform_at(kind, w, h, col, row, &new_col,
+                                       &new_row);
+                        memcpy(A2Layout_at(&dst, new_col, new_row), average,
+                               RGB_SIZE);
+                }
+        }
+        free(sums);
+}
+
+/********** A2Layout_of ********
+ *
+ * Builds the layout of an array made by uarray2_methods_plain or
+ * uarray2_methods_blocked
+ *
+ * Parameters:
+ *      A2Methods_T methods: the suite that made the array
+ *      A2Methods_UArray2 array: the array
+ *      A2Layout *layout: filled in on success
+ *
+ * Return:
+ *      true if the array's storage follows the A2Layout order
+ *
+ * Notes:
+ *      Only the first and last cells are compared with the formula, so
+ *      this is a sanity check that the suite is one we know, not proof
+ ************************/
+bool A2Layout_of(A2Methods_T methods, A2Methods_UArray2 array,
+                 A2Layout *layout)
+{
+        int width = methods->width(array);
+        int height = methods->height(array);
+        if (width <= 0 || height <= 0) {
+                return false;
+        }
+
+        *layout = A2Layout_new(methods->at(array, 0, 0), width, height,
+                               methods->size(array),
+                               methods->blocksize(array));
+
+        return A2Layout_at(layout, width - 1, height - 1)
+               == methods->at(array, width - 1, height - 1);
+}
@@ -0,0 +1,166 @@
+/**************************************************************
+ *
+ *                     a2transform.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to the transform engine shared by a2plain.c and
+ *     a2blocked.c.  The engine works on an A2Layout, a raw view of the
+ *     storage behind a plain or blocked array, so it can move cells
+ *     with pointer arithmetic instead of a methods->at call per pixel.
+ *
+ **************************************************************/
+
+#ifndef A2TRANSFORM_INCLUDED
+#define A2TRANSFORM_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+
+/*
+ * the rotations and flips an image can go through: the eight symmetries
+ * of a rectangle.  A2_TRANSVERSE is the anti-transpose, mirroring the
+ * image across its other diagonal.
+ */
+typedef enum A2Transform_T {
+        A2_ROTATE_0,
+        A2_ROTATE_90,
+        A2_ROTATE_180,
+        A2_ROTATE_270,
+        A2_FLIP_HORIZONTAL,
+        A2_FLIP_VERTICAL,
+        A2_TRANSPOSE,
+        A2_TRANSVERSE
+} A2Transform_T;
+
+/* the orders in which a transform can visit the source image */
+typedef enum A2Traversal_T {
+        A2_ROW_MAJOR,
+        A2_COL_MAJOR,
+        A2_BLOCK_MAJOR
+} A2Traversal_T;
+
+/*
+ * Raw view of an array whose cells live in one allocation.  Cell
+ * (col, row) is stored at cell index
+ *
+ *     (row / bs * blocks_wide + col / bs) * bs * bs
+ *             + (row % bs) * bs + col % bs
+ *
+ * where bs is the blocksize.  A UArray2b uses exactly this order, and a
+ * plain row-major UArray2 is the special case bs == 1.
+ */
+typedef struct A2Layout {
+        char *base;
+        int width, height, size;
+        int blocksize, blocks_wide;
+} A2Layout;
+
+extern A2Layout A2Layout_new(void *base, int width, int height, int size,
+                             int blocksize);
+
+/* layout of an array from one of the built-in suites; false if its
+ * storage does not follow the order above
+ */
+extern bool A2Layout_of(A2Methods_T methods, A2Methods_UArray2 array,
+                        A2Layout *layout);
+
+static inline void *A2Layout_at(const A2Layout *layout, int col, int row)
+{
+        int bs = layout->blocksize;
+        size_t index = (size_t)((row / bs) * layout->blocks_wide + col / bs)
+                       * bs * bs + (row % bs) * bs + col % bs;
+        return layout->base + index * layout->size;
+}
+
+/* width and height of the image once 'kind' has been applied */
+extern void A2Transform_dims(A2Transform_T kind, int width, int height,
+                             int *new_width, int *new_height);
+
+/* where the cell at (col, row) of a width x height image ends up */
+extern void A2Transform_at(A2Transform_T kind, int width, int height,
+                           int col, int row, int *new_col, int *new_row);
+
+/*
+ * the single transform that has the same effect as applying first and
+ * then second
+ */
+extern A2Transform_T A2Transform_compose(A2Transform_T first,
+                                         A2Transform_T second);
+
+/*
+ * copies every cell of src into its transformed place in dst, one
+ * cache-sized tile at a time.  dst must have the dimensions given by
+ * A2Transform_dims and the same cell size as src (checked runtime error)
+ */
+extern void A2Transform_apply(A2Transform_T kind, A2Layout src, A2Layout dst);
+
+/* true if A2Transform_in_place can apply kind to a width x height image */
+extern bool A2Transform_in_place_ok(A2Transform_T kind, int width,
+                                    int height);
+
+/*
+ * overwrites image with its transformed self, swapping cells in pairs
+ * instead of filling a second array
+ */
+extern void A2Transform_in_place(A2Transform_T kind, A2Layout image);
+
+/*
+ * applies any transform inside image's storage, including quarter turns
+ * of non-square images, by following the permutation's cycles with a
+ * one-bit-per-cell visited map; returns the layout of the result
+ * (same storage and blocksize, possibly swapped dimensions)
+ */
+extern A2Layout A2Transform_in_place_cycles(A2Transform_T kind,
+                                            A2Layout image);
+
+/*
+ * same result as A2Transform_apply, visiting the source in the given
+ * order through a kernel specialised at compile time for the
+ * representation, transform and traversal
+ */
+extern void A2Transform_traverse(A2Transform_T kind, A2Traversal_T order,
+                                 A2Layout src, A2Layout dst);
+
+/*
+ * A2Transform_traverse for source rows row_lo ... row_hi - 1 only.  The
+ * cells written are the images of those rows and nothing else, so calls
+ * for disjoint row ranges can run in parallel
+ */
+extern void A2Transform_traverse_rows(A2Transform_T kind,
+                                      A2Traversal_T order, A2Layout src,
+                                      A2Layout dst, int row_lo, int row_hi);
+
+/*
+ * true if A2Transform_traverse does kind in the given order with one of
+ * its hand-vectorised engines (cells of 'size' bytes), rather than with
+ * a generated kernel
+ */
+extern bool A2Transform_has_engine(A2Transform_T kind, A2Traversal_T order,
+                                   int size);
+
+/* the row count a range should be a multiple of to keep tiles whole */
+extern int A2Transform_grain(A2Layout src);
+
+/*
+ * width and height of a width x height image shrunk by factor, a part
+ * block at the right or bottom edge making a cell of its own
+ */
+extern void A2Transform_reduced_dims(int factor, int width, int height,
+                                     int *new_width, int *new_height);
+
+/*
+ * shrinks src by factor, averaging each factor x factor block of cells
+ * into one, and puts the result through kind into dst, in one pass
+ * over src.  Cells must be three unsigned channels (a struct Pnm_rgb),
+ * and dst must have the dimensions A2Transform_dims gives for the
+ * reduced image (checked runtime errors)
+ */
+extern void A2Transform_reduce(A2Transform_T kind, int factor, A2Layout src,
+                               A2Layout dst);
+
+#endif
@@ -0,0 +1,274 @@
+/**************************************************************
+ *
+ *                     a2watch.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the watched methods suite.  Each function
+ *     passes straight through to the inner suite's; at() reports the
+ *     pointer it got back, and each mapping function puts a closure of
+ *     its own between the inner map and the caller's apply function,
+ *     reporting each element before handing it on.  A map or at() of
+ *     the inner suite that is NULL stays NULL.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+
+#include "assert.h"
+#include "a2watch.h"
+
+typedef A2Methods_UArray2 A2;   // private abbreviation
+
+/* arrays that can carry a label at once */
+#define MAX_LABELS 8
+
+static A2Methods_T inner;
+static A2Watch_observer *observe;
+static void *observe_cl;
+
+static struct {
+        A2 array;
+        int label;
+} labels[MAX_LABELS];
+
+void A2Watch_label(A2 array, int label)
+{
+        assert(array != NULL && label >= 0);
+        int free_slot = -1;
+        for (int i = 0; i < MAX_LABELS; i++) {
+                if (labels[i].array == array) {
+                        labels[i].label = label;
+                        return;
+                }
+                if (labels[i].array == NULL && free_slot < 0) {
+                        free_slot = i;
+                }
+        }
+        assert(free_slot >= 0);
+        labels[free_slot].array = array;
+        labels[free_slot].label = label;
+}
+
+static int label_of(A2 array)
+{
+        for (int i = 0; i < MAX_LABELS; i++) {
+                if (labels[i].array == array) {
+                        return labels[i].label;
+                }
+        }
+        return -1;
+}
+
+static A2 new(int width, int height, int size)
+{
+        return inner->new(width, height, size);
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+        return inner->new_with_blocksize(width, height, size, blocksize);
+}
+
+static void a2free(A2 *array2p)
+{
+        for (int i = 0; i < MAX_LABELS; i++) {
+                if (labels[i].array == *array2p) {
+                        labels[i].array = NULL;
+                }
+        }
+        inner->free(array2p);
+}
+
+static int width(A2 array2)
+{
+        return inner->width(array2);
+}
+
+static int height(A2 array2)
+{
+        return inner->height(array2);
+}
+
+static int size(A2 array2)
+{
+        return inner->size(array2);
+}
+
+static int blocksize(A2 array2)
+{
+        return inner->blocksize(array2);
+}
+
+static A2Methods_Object *at(A2 array2, int i, int j)
+{
+        A2Methods_Object *elem = inner->at(array2, i, j);
+        observe(elem, inner->size(array2), A2WATCH_AT, label_of(array2),
+                observe_cl);
+        return elem;
+}
+
+/* what a watched map hands the inner one in place of the caller's */
+struct closure {
+        union {
+                A2Methods_applyfun *apply;
+                A2Methods_smallapplyfun *small;
+                A2Methods_spanapplyfun *span;
+        } fun;
+        void *cl;
+        int label, size;
+};
+
+static void apply_watched(int i, int j, A2 array2, A2Methods_Object *elem,
+                          void *vcl)
+{
+        struct closure *cl = vcl;
+        observe(elem, cl->size, A2WATCH_MAP, cl->label, observe_cl);
+        cl->fun.apply(i, j, array2, elem, cl->cl);
+}
+
+static void apply_small_watched(A2Methods_Object *elem, void *vcl)
+{
+        struct closure *cl = vcl;
+        observe(elem, cl->size, A2WATCH_MAP, cl->label, observe_cl);
+        cl->fun.small(elem, cl->cl);
+}
+
+static void apply_span_watched(A2Methods_Object *elem, int count, int col,
+                               int row, void *vcl)
+{
+        struct closure *cl = vcl;
+        observe(elem, count * cl->size, A2WATCH_MAP, cl->label, observe_cl);
+        cl->fun.span(elem, count, col, row, cl->cl);
+}
+
+static struct closure closure_for(A2 array2, void *cl)
+{
+        struct closure mycl = {
+                .cl = cl, .label = label_of(array2),
+                .size = inner->size(array2)
+        };
+        return mycl;
+}
+
+static void map_row_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.apply = apply;
+        inner->map_row_major(array2, apply_watched, &mycl);
+}
+
+static void map_col_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.apply = apply;
+        inner->map_col_major(array2, apply_watched, &mycl);
+}
+
+static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.apply = apply;
+        inner->map_block_major(array2, apply_watched, &mycl);
+}
+
+static void map_default(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.apply = apply;
+        inner->map_default(array2, apply_watched, &mycl);
+}
+
+static void small_map_row_major(A2 array2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.small = apply;
+        inner->small_map_row_major(array2, apply_small_watched, &mycl);
+}
+
+static void small_map_col_major(A2 array2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.small = apply;
+        inner->small_map_col_major(array2, apply_small_watched, &mycl);
+}
+
+static void small_map_block_major(A2 array2, A2Methods_smallapplyfun apply,
+                                  void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.small = apply;
+        inner->small_map_block_major(array2, apply_small_watched, &mycl);
+}
+
+static void small_map_default(A2 array2, A2Methods_smallapplyfun apply,
+                              void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.small = apply;
+        inner->small_map_default(array2, apply_small_watched, &mycl);
+}
+
+static void map_spans_row_major(A2 array2, A2Methods_spanapplyfun apply,
+                                void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.span = apply;
+        inner->map_spans_row_major(array2, apply_span_watched, &mycl);
+}
+
+static void map_spans_block_major(A2 array2, A2Methods_spanapplyfun apply,
+                                  void *cl)
+{
+        struct closure mycl = closure_for(array2, cl);
+        mycl.fun.span = apply;
+        inner->map_spans_block_major(array2, apply_span_watched, &mycl);
+}
+
+/* the wrapper of fun, or NULL if the inner suite has no fun */
+#define IF_INNER(fun) (inner->fun != NULL ? fun : NULL)
+
+static struct A2Methods_T watched_struct;
+
+A2Methods_T A2Watch_methods(A2Methods_T inner_methods,
+                            A2Watch_observer *observe_fun, void *cl)
+{
+        assert(inner_methods != NULL && observe_fun != NULL);
+        inner = inner_methods;
+        observe = observe_fun;
+        observe_cl = cl;
+
+        struct A2Methods_T watched = {
+                new,
+                new_with_blocksize,
+                a2free,
+                width,
+                height,
+                size,
+                blocksize,
+                at,
+                IF_INNER(map_row_major),
+                IF_INNER(map_col_major),
+                IF_INNER(map_block_major),
+                IF_INNER(map_default),
+                IF_INNER(small_map_row_major),
+                IF_INNER(small_map_col_major),
+                IF_INNER(small_map_block_major),
+                IF_INNER(small_map_default),
+                IF_INNER(map_spans_row_major),
+                IF_INNER(map_spans_block_major),
+                NULL,           // rotate90
+                NULL,           // rotate180
+                NULL,           // rotate270
+                NULL,           // flip_h
+                NULL,           // flip_v
+                NULL,           // transpose
+                NULL,           // transverse
+        };
+        watched_struct = watched;
+        return &watched_struct;
+}
@@ -0,0 +1,57 @@
+/**************************************************************
+ *
+ *                     a2watch.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to a methods suite that wraps another and reports
+ *     every element it hands out: each pointer at() returns and each
+ *     cell (or run of cells) a mapping function passes to its apply
+ *     function.  Code using the wrapped suite runs as before, and the
+ *     observer sees the addresses it touches, in order, which is what
+ *     the cache simulator and the access tracer are fed.
+ *
+ *     The suite's functions cannot carry state of their own, so there
+ *     is one watched suite at a time, and it is not thread-safe.
+ *
+ **************************************************************/
+
+#ifndef A2WATCH_INCLUDED
+#define A2WATCH_INCLUDED
+
+#include "a2methods.h"
+
+#define A2 A2Methods_UArray2
+
+/* how an element was reached */
+typedef enum A2Watch_kind {
+        A2WATCH_AT,     /* returned by at() */
+        A2WATCH_MAP     /* passed to an apply function by a map */
+} A2Watch_kind;
+
+/*
+ * told of each element reached, 'bytes' long at address, in the array
+ * with the given label (-1 for an array with none); a span map reports
+ * each run as one access of all its bytes
+ */
+typedef void A2Watch_observer(const void *address, int bytes,
+                              A2Watch_kind kind, int label, void *cl);
+
+/*
+ * the methods of inner, with observe called with cl on every element
+ * reached through them.  The wrapped suite has no native transforms, so
+ * a transform through it goes cell by cell where it can be watched.
+ * Calling this again rewraps the same suite: the old wrapping is gone
+ */
+extern A2Methods_T A2Watch_methods(A2Methods_T inner,
+                                   A2Watch_observer *observe, void *cl);
+
+/* tags the accesses to array with label, a number 0 or over; an array
+ * made by the wrapped suite, or the inner one, is unlabelled until then
+ */
+extern void A2Watch_label(A2 array, int label);
+
+#undef A2
+#endif
@@ -0,0 +1,659 @@
+/**************************************************************
+ *
+ *                     batch.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of ppmtrans's batch mode (-outdir).  Worker threads
+ *     take files one at a time, read them with ppmstream (or Pnm_ppmread,
+ *     alone, for formats other than P6) into arrays they keep from one 
+ *     file to the next, and write each result into the output 
+ *     directory.  A file that cannot be read is reported and
+ *     skipped without stopping the others.
+ *
+ *     CII keeps one stack of TRY frames for the whole process, so while
+ *     a worker is inside the TRY around Pnm_ppmread no other worker may
+ *     be anywhere it could assert or RAISE; a gate lets the workers 
+ *     process files together, or one of them decode alone.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "assert.h"
+#include "except.h"
+#include "a2plain.h"
+#include "cputiming.h"
+#include "batch.h"
+
+#define CLAIM_BUCKETS 1024
+
+/* an output path handed out, and the input it was handed out for */
+struct Claim {
+        char *out_path;
+        char *path;
+        struct Claim *next;
+};
+
+/* the files of a batch, handed out to the workers one at a time */
+struct Batch {
+        const struct Options *options;
+        char **files;           /* from the command line, or ... */
+        int nfiles, next;
+        FILE *manifest;         /* ... one path per line when nfiles == 0 */
+        int failures;
+        struct Claim *claims[CLAIM_BUCKETS];    /* outputs handed out so
+                                                   far, by hash */
+        mode_t mode;            /* of the outputs, as fopen would make 
+                                   them */
+        pthread_mutex_t lock;   /* guards all of the above, the gate 
+                                   and the time file */
+        int inside;             /* workers through the gate */
+        int decoders;           /* workers waiting to decode, or decoding */
+        bool decoding;          /* one worker is in Pnm_ppmread */
+        pthread_cond_t gate_changed;
+};
+
+/* what a worker keeps from one file to the next */
+struct Worker {
+        struct Batch *batch;
+        CPUTime_T timer;
+        struct Phases phases;   /* -phases times of the current file */
+        A2 pixels;      /* source array, reused when the size matches */
+        A2 trans;       /* destination array, likewise */
+        A2Plan_T plan;  /* -plan for those two arrays, or NULL */
+        pthread_t thread;
+};
+
+/* outdir/name, where name is the last component of path */
+static char *output_path(const char *outdir, const char *path)
+{
+        const char *name = path;
+        for (const char *c = path; *c != '\0'; c++) {
+                if (*c == '/') {
+                        name = c + 1;
+                }
+        }
+        size_t length = strlen(outdir) + strlen(name) + 2;
+
+        char *out = malloc(length);
+        assert(out != NULL);
+        snprintf(out, length, "%s/%s", outdir, name);
+        return out;
+}
+
+/* the next path of the batch (to be freed by the caller), or NULL; 
+ * batch->lock must be held */
+static char *next_path(struct Batch *batch)
+{
+        char *path = NULL;
+
+        if (batch->manifest == NULL) {
+                if (batch->next < batch->nfiles) {
+                        path = strdup(batch->files[batch->next++]);
+                        assert(path != NULL);
+                }
+        } else {
+                size_t capacity = 0;
+                ssize_t length;
+                while ((length = getline(&path, &capacity, 
+                                         batch->manifest)) >= 0) {
+                        while (length > 0 && (path[length - 1] == '\n' 
+                                              || path[length - 1] == '\r')) {
+                                path[--length] = '\0';
+                        }
+                        if (length > 0) {
+                                break;
+                        }
+                }
+                if (length < 0) {
+                        free(path);
+                        path = NULL;
+                }
+        }
+
+        return path;
+}
+
+/* hands out path's output, returning NULL, or if an earlier path has it
+ * already, that path; batch->lock must be held */
+static const char *claim_output(struct Batch *batch, const char *path)
+{
+        char *out_path = output_path(batch->options->outdir, path);
+        unsigned long hash = 5381;
+        for (const char *c = out_path; *c != '\0'; c++) {
+                hash = hash * 33 + (unsigned char)*c;
+        }
+        struct Claim **bucket = &batch->claims[hash % CLAIM_BUCKETS];
+
+        for (struct Claim *claim = *bucket; claim != NULL; 
+             claim = claim->next) {
+                if (strcmp(claim->out_path, out_path) == 0) {
+                        free(out_path);
+                        return claim->path;
+                }
+        }
+        struct Claim *claim = malloc(sizeof(*claim));
+        assert(claim != NULL);
+        claim->out_path = out_path;
+        claim->path = strdup(path);
+        assert(claim->path != NULL);
+        claim->next = *bucket;
+        *bucket = claim;
+        return NULL;
+}
+
+/* the next path to process (to be freed by the caller), or NULL.  A path
+ * whose output an earlier path already has, such as b/x.ppm after 
+ * a/x.ppm, is reported as a failure and skipped */
+static char *next_file(struct Batch *batch)
+{
+        char *path;
+
+        pthread_mutex_lock(&batch->lock);
+        while ((path = next_path(batch)) != NULL) {
+                const char *owner = claim_output(batch, path);
+                if (owner == NULL) {
+                        break;
+                }
+                fprintf(stderr, "ppmtrans: %s: same output as %s\n", path,
+                        owner);
+                batch->failures++;
+                free(path);
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        return path;
+}
+
+/* makes *array a width x height array of 'size'-byte pixels, reusing 
+ * it if it is one already */
+static void fit_array(const struct Options *options, A2 *array, int width, 
+                      int height, int size)
+{
+        A2Methods_T methods = options->methods;
+        if (*array != NULL && methods->width(*array) == width 
+            && methods->height(*array) == height 
+            && methods->size(*array) == size) {
+                return;
+        }
+        if (*array != NULL) {
+                methods->free(array);
+        }
+        *array = new_pixels(options, width, height, size);
+}
+
+static void batch_failure(struct Batch *batch, const char *path, 
+                          const char *why)
+{
+        pthread_mutex_lock(&batch->lock);
+        fprintf(stderr, "ppmtrans: %s: %s\n", path, why);
+        batch->failures++;
+        pthread_mutex_unlock(&batch->lock);
+}
+
+/* a file of a batch that resolves to its input, which writing it would
+destroy */
+static bool same_file(FILE *in, const char *out_path)
+{
+        struct stat in_stat, out_stat;
+        return fstat(fileno(in), &in_stat) == 0 
+               && stat(out_path, &out_stat) == 0
+               && in_stat.st_dev == out_stat.st_dev 
+               && in_stat.st_ino == out_stat.st_ino;
+}
+
+/* a new file beside out_path for its contents, whose name is stored in 
+ * *tmp_path (to be freed by the caller); NULL, with errno set, if it 
+ * cannot be made */
+static FILE *open_temporary(struct Batch *batch, const char *out_path, 
+                            char **tmp_path)
+{
+        size_t length = strlen(out_path) + sizeof(".XXXXXX");
+        char *name = malloc(length);
+        assert(name != NULL);
+        snprintf(name, length, "%s.XXXXXX", out_path);
+
+        FILE *out = NULL;
+        int fd = mkstemp(name);
+        if (fd >= 0) {
+                fchmod(fd, batch->mode);
+                out = fdopen(fd, "wb");
+                if (out == NULL) {
+                        int error = errno;
+                        close(fd);
+                        remove(name);
+                        errno = error;
+                }
+        }
+        if (out == NULL) {
+                free(name);
+                return NULL;
+        }
+        *tmp_path = name;
+        return out;
+}
+
+/* batch_failure for a file whose output was opened, whose temporary file
+ * is removed */
+static void batch_abandon(struct Batch *batch, const char *path, 
+                          const char *why, FILE *in, FILE *out, 
+                          char *out_path, char *tmp_path)
+{
+        batch_failure(batch, path, why);
+        fclose(in);
+        fclose(out);
+        remove(tmp_path);
+        free(tmp_path);
+        free(out_path);
+}
+
+/* lets a worker through the gate, once no other worker is waiting to 
+decode */
+static void gate_enter(struct Batch *batch)
+{
+        pthread_mutex_lock(&batch->lock);
+        while (batch->decoders > 0) {
+                pthread_cond_wait(&batch->gate_changed, &batch->lock);
+        }
+        batch->inside++;
+        pthread_mutex_unlock(&batch->lock);
+}
+
+static void gate_leave(struct Batch *batch)
+{
+        pthread_mutex_lock(&batch->lock);
+        batch->inside--;
+        pthread_cond_broadcast(&batch->gate_changed);
+        pthread_mutex_unlock(&batch->lock);
+}
+
+/* lets a worker through the gate with no other worker through it */
+static void gate_enter_alone(struct Batch *batch)
+{
+        pthread_mutex_lock(&batch->lock);
+        batch->decoders++;
+        while (batch->inside > 0 || batch->decoding) {
+                pthread_cond_wait(&batch->gate_changed, &batch->lock);
+        }
+        batch->decoding = true;
+        pthread_mutex_unlock(&batch->lock);
+}
+
+static void gate_leave_alone(struct Batch *batch)
+{
+        pthread_mutex_lock(&batch->lock);
+        batch->decoding = false;
+        batch->decoders--;
+        pthread_cond_broadcast(&batch->gate_changed);
+        pthread_mutex_unlock(&batch->lock);
+}
+
+/* Pnm_ppmread of in for a worker through the gate, into a plain array; 
+ * NULL if in is not an image Pnm_ppmread can read.  The worker leaves 
+ * the gate and comes back through it alone, so that no other worker can
+ * raise into its TRY */
+static Pnm_ppm batch_ppmread(struct Batch *batch, FILE *in)
+{
+        Pnm_ppm volatile image = NULL;
+
+        gate_leave(batch);
+        gate_enter_alone(batch);
+        TRY
+                image = Pnm_ppmread(in, uarray2_methods_plain);
+        EXCEPT(Pnm_Badformat)
+                image = NULL;
+        END_TRY;
+        gate_leave_alone(batch);
+        gate_enter(batch);
+        return image;
+}
+
+/********** batch_file ********
+ *
+ * Transforms one file of a batch into the output directory
+ *
+ * Parameters:
+ *      struct Worker *worker: the worker doing it
+ *      const char *path: the input file
+ *
+ * Return: 
+ *      None
+ *
+ * Notes:
+ *      A P6 image is read with ppmstream rather than Pnm_ppmread so it
+ *      can go into the worker's existing array, and so that workers 
+ *      never share decoder state.  Any other format goes through 
+ *      Pnm_ppmread, with no other worker running, and is copied into 
+ *      the array.  A file that cannot be opened, is not an image or ends 
+ *      early is reported and skipped; the other workers carry on.  The
+ *      output is written to a temporary file beside it and renamed into
+ *      place only once it is complete, so a file that fails leaves any
+ *      earlier output alone, and an output that is the input itself is 
+ *      refused rather than truncated before it is read.  With -phases each
+ *      file that is written gets its own line, timed on the worker's 
+ *      thread; allocation is only what growing the worker's arrays 
+ *      costs, and with -plan what replanning for a new size costs.
+ ************************/
+static void batch_file(struct Worker *worker, const char *path)
+{
+        struct Batch *batch = worker->batch;
+        const struct Options *options = batch->options;
+        A2Methods_T methods = options->methods;
+        A2Transform_T kind = options->kind;
+        struct Phases *phases = options->phases_file_name != NULL 
+                                ? &worker->phases : NULL;
+        if (phases != NULL) {
+                Phases_reset(phases);
+        }
+
+        Phases_start(phases);
+        FILE *in = fopen(path, "rb");
+        if (in == NULL) {
+                batch_failure(batch, path, strerror(errno));
+                return;
+        }
+        char *out_path = output_path(options->outdir, path);
+        if (same_file(in, out_path)) {
+                batch_failure(batch, path, "is its own output");
+                free(out_path);
+                fclose(in);
+                return;
+        }
+        char *tmp_path;
+        FILE *out = open_temporary(batch, out_path, &tmp_path);
+        if (out == NULL) {
+                batch_failure(batch, out_path, strerror(errno));
+                free(out_path);
+                fclose(in);
+                return;
+        }
+        Phases_stop(phases, PHASE_OPEN);
+
+        /* a P6 is a stream, anything else a whole image Pnm_ppmread 
+        decoded */
+        Phases_start(phases);
+        Ppmstream_T stream = NULL;
+        Pnm_ppm plain = NULL;
+        int magic = Ppmstream_read_magic(in);
+        if (magic != '6') {
+                if (options->crop) {
+                        batch_abandon(batch, path, "-crop needs a binary "
+                                      "(P6) image", in, out, out_path, 
+                                      tmp_path);
+                        return;
+                }
+                FILE *whole = Ppmstream_unread_magic(in, magic);
+                plain = batch_ppmread(batch, whole);
+                if (whole != in) {
+                        fclose(whole);
+                }
+                if (plain == NULL) {
+                        batch_abandon(batch, path, "not a PPM image", in, 
+                                      out, out_path, tmp_path);
+                        return;
+                }
+        } else {
+                stream = Ppmstream_try_open_after_magic(in);
+                if (stream == NULL) {
+                        batch_abandon(batch, path, "not a PPM image", in, 
+                                      out, out_path, tmp_path);
+                        return;
+                }
+                if (!crop_stream(options, stream)) {
+                        Ppmstream_free(&stream);
+                        batch_abandon(batch, path, "crop does not fit in "
+                                      "the image", in, out, out_path, 
+                                      tmp_path);
+                        return;
+                }
+        }
+        int width = stream != NULL ? (int)Ppmstream_width(stream) 
+                                   : (int)plain->width;
+        int height = stream != NULL ? (int)Ppmstream_height(stream) 
+                                    : (int)plain->height;
+        unsigned denominator = stream != NULL 
+                               ? Ppmstream_denominator(stream)
+                               : plain->denominator;
+        double time_used;
+        Phases_stop(phases, PHASE_PARSE);
+
+        const char *suite = "stream";
+        int blocksize = 0;
+        if (options->stream && !resamples(options) && stream != NULL) {
+                Phases_start(phases);
+                CPUTime_Start(worker->timer);
+                Ppmstream_transform(kind, stream, out, options->memory);
+                time_used = CPUTime_Stop(worker->timer);
+                Phases_stop(phases, PHASE_TRANSFORM);
+        } else {
+                Phases_start(phases);
+                fit_array(options, &worker->pixels, width, height,
+                          pixel_size(options, denominator));
+                Phases_stop(phases, PHASE_ALLOC);
+                Phases_start(phases);
+                if (stream != NULL) {
+                        Ppmstream_read_pixels(stream, methods, 
+                                              worker->pixels);
+                } else {
+                        Ppmstream_copy_pixels(plain->methods, 
+                                              plain->pixels, methods, 
+                                              worker->pixels);
+                        Pnm_ppmfree(&plain);
+                }
+                Phases_stop(phases, PHASE_PARSE);
+                if (stream != NULL && Ppmstream_truncated(stream)) {
+                        Ppmstream_free(&stream);
+                        batch_abandon(batch, path, "image ends early", in,
+                                      out, out_path, tmp_path);
+                        return;
+                }
+                suite = suite_name(methods);
+                blocksize = methods->blocksize(worker->pixels);
+                A2 result;
+
+                if (options->in_place && !resamples(options)
+                    && can_transform_in_place(methods, kind, width, 
+                                              height)) {
+                        struct Pnm_ppm image = {
+                                .width = width, .height = height,
+                                .denominator = denominator,
+                                .pixels = worker->pixels,
+                                .methods = methods
+                        };
+                        Phases_start(phases);
+                        CPUTime_Start(worker->timer);
+                        transform_in_place(methods, kind, &image);
+                        time_used = CPUTime_Stop(worker->timer);
+                        Phases_stop(phases, PHASE_TRANSFORM);
+                        result = worker->pixels;
+                } else {
+                        int new_width, new_height;
+                        result_dims(options, width, height, &new_width,
+                                    &new_height);
+                        Phases_start(phases);
+                        fit_array(options, &worker->trans, new_width, 
+                                  new_height, 
+                                  methods->size(worker->pixels));
+                        bool planned = options->plan && !resamples(options)
+                                       && fit_plan(&worker->plan, methods, 
+                                                   options->map, kind,
+                                                   worker->pixels, 
+                                                   worker->trans);
+                        Phases_stop(phases, PHASE_ALLOC);
+                        Phases_start(phases);
+                        CPUTime_Start(worker->timer);
+                        if (resamples(options)) {
+                                resample_into(options, worker->pixels, 
+                                              worker->trans);
+                        } else if (planned) {
+                                planned_transform_into(worker->plan, 
+                                                       methods, 
+                                                       worker->pixels,
+                                                       worker->trans);
+                        } else {
+                                transform_into(methods, options->map, 
+                                               kind, worker->pixels, 
+                                               worker->trans);
+                        }
+                        time_used = CPUTime_Stop(worker->timer);
+                        Phases_stop(phases, PHASE_TRANSFORM);
+                        result = worker->trans;
+                }
+                Phases_start(phases);
+                Ppmstream_write_pixels(out, methods, result, denominator);
+                Phases_stop(phases, PHASE_WRITE);
+        }
+
+        if (stream != NULL && Ppmstream_truncated(stream)) {
+                Ppmstream_free(&stream);
+                batch_abandon(batch, path, "image ends early", in, out, 
+                              out_path, tmp_path);
+                return;
+        }
+        if (options->time_file_name != NULL) {
+                pthread_mutex_lock(&batch->lock);
+                write_the_timing(options->time_file_name, time_used, 
+                                 width, height);
+                pthread_mutex_unlock(&batch->lock);
+        }
+
+        Phases_start(phases);
+        bool written = fflush(out) == 0;
+        Phases_stop(phases, PHASE_WRITE);
+
+        Phases_start(phases);
+        if (stream != NULL) {
+                Ppmstream_free(&stream);
+        }
+        fclose(in);
+        written = fclose(out) == 0 && written;
+        written = written && rename(tmp_path, out_path) == 0;
+        Phases_stop(phases, PHASE_FREE);
+        if (!written) {
+                batch_failure(batch, out_path, strerror(errno));
+                remove(tmp_path);
+        } else if (phases != NULL) {
+                pthread_mutex_lock(&batch->lock);
+                Phases_write(options, phases, path, suite, blocksize, width,
+                             height);
+                pthread_mutex_unlock(&batch->lock);
+        }
+        free(tmp_path);
+        free(out_path);
+}
+
+static void *batch_worker(void *cl)
+{
+        struct Worker *worker = cl;
+        const struct Options *options = worker->batch->options;
+        char *path;
+
+        gate_enter(worker->batch);
+        Phases_init(&worker->phases, true, options->counters);
+        gate_leave(worker->batch);
+        while ((path = next_file(worker->batch)) != NULL) {
+                gate_enter(worker->batch);
+                batch_file(worker, path);
+                gate_leave(worker->batch);
+                free(path);
+        }
+        Phases_free(&worker->phases);
+        return NULL;
+}
+
+/********** Batch_run ********
+ *
+ * Transforms every file of a batch into options->outdir, using 
+ * options->jobs workers
+ *
+ * Parameters:
+ *      const struct Options *options: what to do to each file
+ *      char **files, int nfiles: the inputs; with none, the paths are 
+ *                                read from stdin, one per line
+ *
+ * Return: 
+ *      the number of files that could not be processed
+ *
+ * Notes:
+ *      One process does the whole batch, so the methods suite is set 
+ *      up once, and each worker keeps one timer and its last source 
+ *      and destination arrays, which are reused whenever the next 
+ *      image has the same size, as is its -plan.  Each timer measures
+ *      its own thread, so -time still records the CPU time of each 
+ *      transform alone, and -phases the CPU time of each file.  
+ *      Outputs are named by the last component of each input, so of 
+ *      two inputs with the same name only the first is transformed; 
+ *      the other is a failure.
+ ************************/
+int Batch_run(const struct Options *options, char **files, int nfiles)
+{
+        if (mkdir(options->outdir, 0777) != 0 && errno != EEXIST) {
+                fprintf(stderr, "ppmtrans: %s: %s\n", options->outdir, 
+                        strerror(errno));
+                return nfiles > 0 ? nfiles : 1;
+        }
+
+        mode_t mask = umask(0);
+        umask(mask);
+        struct Batch batch = {
+                .options = options,
+                .files = files, .nfiles = nfiles, .next = 0,
+                .manifest = nfiles == 0 ? stdin : NULL,
+                .failures = 0,
+                .mode = 0666 & ~mask
+        };
+        pthread_mutex_init(&batch.lock, NULL);
+        pthread_cond_init(&batch.gate_changed, NULL);
+
+        int jobs = options->jobs;
+        if (nfiles > 0 && jobs > nfiles) {
+                jobs = nfiles;
+        }
+        struct Worker *workers = calloc(jobs, sizeof(*workers));
+        assert(workers != NULL);
+
+        for (int i = 0; i < jobs; i++) {
+                workers[i].batch = &batch;
+                workers[i].timer = CPUTime_NewThread();
+                int error = pthread_create(&workers[i].thread, NULL, 
+                                           batch_worker, &workers[i]);
+                assert(error == 0);
+                (void)error;
+        }
+        for (int i = 0; i < jobs; i++) {
+                pthread_join(workers[i].thread, NULL);
+                CPUTime_Free(&workers[i].timer);
+                if (workers[i].pixels != NULL) {
+                        options->methods->free(&workers[i].pixels);
+                }
+                if (workers[i].trans != NULL) {
+                        options->methods->free(&workers[i].trans);
+                }
+                if (workers[i].plan != NULL) {
+                        A2Plan_free(&workers[i].plan);
+                }
+        }
+
+        free(workers);
+        for (int i = 0; i < CLAIM_BUCKETS; i++) {
+                while (batch.claims[i] != NULL) {
+                        struct Claim *claim = batch.claims[i];
+                        batch.claims[i] = claim->next;
+                        free(claim->out_path);
+                        free(claim->path);
+                        free(claim);
+                }
+        }
+        pthread_mutex_destroy(&batch.lock);
+        pthread_cond_destroy(&batch.gate_changed);
+        return batch.failures;
+}
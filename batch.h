@@ -0,0 +1,27 @@
+/**************************************************************
+ *
+ *                     batch.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to ppmtrans's batch mode, which transforms many files
+ *     into a directory with -jobs worker threads.
+ *
+ **************************************************************/
+
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include "ppmtrans.h"
+
+/*
+ * transforms files[0..nfiles-1], or with nfiles 0 the paths on stdin,
+ * one per line, into options->outdir.  Returns the number of files
+ * that failed, each of which has been reported on stderr
+ */
+extern int Batch_run(const struct Options *options, char **files,
+                     int nfiles);
+
+#endif
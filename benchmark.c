@@ -0,0 +1,319 @@
+/**************************************************************
+ *
+ *                     benchmark.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of -benchmark and -blocksize-sweep: every
+ *     configuration is timed over -warmups untimed and -runs timed
+ *     transforms of the same arrays, and reported as the median,
+ *     extremes and quartiles of nanoseconds per pixel, with the mean
+ *     hardware event counts per pixel under -counters.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "assert.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "cputiming.h"
+#include "perfcount.h"
+#include "benchmark.h"
+
+/* block sizes -benchmark tries block-major with; 0 is the suite's own
+default, the largest block that fits in 64KB, and a size on the list 
+that the default turns out to be is not timed twice */
+static const int bench_blocksizes[] = {0, 8, 16, 32, 64, 128};
+
+/* the block size uarray2_methods_blocked picks for cells of 'size' bytes
+when it is given none */
+static int default_blocksize(int size)
+{
+        A2Methods_T methods = uarray2_methods_blocked;
+        A2 probe = methods->new(1, 1, size);
+        int blocksize = methods->blocksize(probe);
+        methods->free(&probe);
+        return blocksize;
+}
+
+/* one configuration's results, in nanoseconds per pixel, and with 
+-counters the mean count of each event per pixel */
+struct Bench_result {
+        A2Transform_T kind;
+        A2Traversal_T order;
+        int blocksize;
+        double median, min, max, p25, p75;
+        bool counted[PERFCOUNT_NEVENTS];
+        double per_pixel[PERFCOUNT_NEVENTS];
+};
+
+static int compare_doubles(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+/* the p-th quantile of n sorted samples, interpolating between them */
+static double quantile(const double *sorted, int n, double p)
+{
+        double at = p * (n - 1);
+        int below = (int)at;
+        if (below + 1 >= n) {
+                return sorted[n - 1];
+        }
+        return sorted[below]
+               + (at - below) * (sorted[below + 1] - sorted[below]);
+}
+
+/********** bench_config ********
+ *
+ * Times one transform, traversal and block size
+ *
+ * Parameters:
+ *      const struct Options *options: warmups and runs
+ *      Pnm_ppm image: the input, in any suite
+ *      A2Transform_T kind: the transform
+ *      A2Traversal_T order: the traversal, which also picks the suite
+ *      int blocksize: for block-major, 0 for the suite's default
+ *      CPUTime_T timer: the timer to use
+ *      Perfcount_T counters: the hardware counters, or NULL
+ *
+ * Return:
+ *      the statistics of the timed runs
+ *
+ * Notes:
+ *      The source is copied into an array of the configuration's suite
+ *      and block size, and both it and the destination are made once,
+ *      so only transform_into is timed, exactly as -time times it.
+ *      With -plan a plan is made with them wherever fit_plan has one 
+ *      to offer, and its execution is timed instead.  The pixels are packed just as they would be in
+ *      a transform of the same image.
+ *      The warmups are run first and thrown away.  The counters are 
+ *      started before the timer and stopped after it, so their own 
+ *      system calls are not in the time.
+ ************************/
+static struct Bench_result bench_config(const struct Options *options,
+                                        Pnm_ppm image, A2Transform_T kind,
+                                        A2Traversal_T order, int blocksize,
+                                        CPUTime_T timer, 
+                                        Perfcount_T counters)
+{
+        A2Methods_T methods = order == A2_BLOCK_MAJOR
+                              ? uarray2_methods_blocked
+                              : uarray2_methods_plain;
+        A2Methods_mapfun *map = map_of(methods, order);
+        int width = image->width;
+        int height = image->height;
+        int new_width, new_height;
+        A2Transform_dims(kind, width, height, &new_width, &new_height);
+
+        int size = pixel_size(options, image->denominator);
+
+        A2 pixels = blocksize == 0
+                    ? methods->new(width, height, size)
+                    : methods->new_with_blocksize(width, height, size,
+                                                  blocksize);
+        A2 trans = methods->new_with_blocksize(new_width, new_height, size,
+                                               methods->blocksize(pixels));
+        Ppmstream_copy_pixels(image->methods, image->pixels, methods, 
+                              pixels);
+        A2Plan_T plan = NULL;
+        if (options->plan) {
+                fit_plan(&plan, methods, map, kind, pixels, trans);
+        }
+
+        double *samples = malloc(options->runs * sizeof(*samples));
+        assert(samples != NULL);
+        uint64_t totals[PERFCOUNT_NEVENTS] = { 0 };
+        for (int i = 0; i < options->warmups + options->runs; i++) {
+                uint64_t counts[PERFCOUNT_NEVENTS];
+                if (counters != NULL) {
+                        Perfcount_Start(counters);
+                }
+                CPUTime_Start(timer);
+                if (plan != NULL) {
+                        planned_transform_into(plan, methods, pixels, trans);
+                } else {
+                        transform_into(methods, map, kind, pixels, trans);
+                }
+                double time_used = CPUTime_Stop(timer);
+                if (counters != NULL) {
+                        Perfcount_Stop(counters, counts);
+                }
+                if (i >= options->warmups) {
+                        samples[i - options->warmups] =
+                                time_used / ((double)width * height);
+                        for (int e = 0; e < PERFCOUNT_NEVENTS 
+                                        && counters != NULL; e++) {
+                                totals[e] += counts[e];
+                        }
+                }
+        }
+        qsort(samples, options->runs, sizeof(*samples), compare_doubles);
+
+        struct Bench_result result = {
+                .kind = kind, .order = order,
+                .blocksize = methods->blocksize(pixels),
+                .median = quantile(samples, options->runs, 0.5),
+                .min = samples[0],
+                .max = samples[options->runs - 1],
+                .p25 = quantile(samples, options->runs, 0.25),
+                .p75 = quantile(samples, options->runs, 0.75)
+        };
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                result.counted[e] = counters != NULL 
+                                    && Perfcount_available(counters, e);
+                result.per_pixel[e] = totals[e] / ((double)options->runs 
+                                                   * width * height);
+        }
+        free(samples);
+        if (plan != NULL) {
+                A2Plan_free(&plan);
+        }
+        methods->free(&trans);
+        methods->free(&pixels);
+        return result;
+}
+
+static void write_bench_result(const struct Options *options,
+                               Pnm_ppm image,
+                               const struct Bench_result *result,
+                               bool first)
+{
+        if (options->format == FORMAT_CSV) {
+                printf("%s,%s,%d,%u,%u,%d,%.3f,%.3f,%.3f,%.3f,%.3f",
+                       kind_names[result->kind],
+                       traversal_names[result->order], result->blocksize,
+                       image->width, image->height, options->runs,
+                       result->median, result->min, result->max,
+                       result->p25, result->p75);
+                for (int e = 0; e < PERFCOUNT_NEVENTS && options->counters;
+                     e++) {
+                        if (result->counted[e]) {
+                                printf(",%.4f", result->per_pixel[e]);
+                        } else {
+                                printf(",");
+                        }
+                }
+                printf("\n");
+                return;
+        }
+        printf("%s\n  {\"transform\": \"%s\", \"traversal\": \"%s\", "
+               "\"blocksize\": %d, \"width\": %u, \"height\": %u, "
+               "\"runs\": %d, \"ns_per_pixel\": {\"median\": %.3f, "
+               "\"min\": %.3f, \"max\": %.3f, \"p25\": %.3f, "
+               "\"p75\": %.3f}",
+               first ? "" : ",", kind_names[result->kind],
+               traversal_names[result->order], result->blocksize,
+               image->width, image->height, options->runs, result->median,
+               result->min, result->max, result->p25, result->p75);
+        if (options->counters) {
+                printf(", \"per_pixel\": {");
+                for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                        printf("%s\"%s\": ", e == 0 ? "" : ", ", 
+                               Perfcount_names[e]);
+                        if (result->counted[e]) {
+                                printf("%.4f", result->per_pixel[e]);
+                        } else {
+                                printf("null");
+                        }
+                }
+                printf("}");
+        }
+        printf("}");
+}
+
+/********** Benchmark_run ********
+ *
+ * Times every transform with every traversal, and block-major with
+ * every distinct block size in bench_blocksizes, on the image in fp.  With
+ * -blocksize block-major is timed with that size alone; with
+ * -blocksize-sweep only the transform the command line asked for is
+ * timed, block-major, with each size of the sweep.
+ *
+ * Parameters:
+ *      FILE *fp: the input image
+ *      const struct Options *options: runs, warmups, format, sizes
+ *
+ * Return:
+ *      None
+ *
+ * Notes:
+ *      Writes one row per configuration to stdout, as CSV with a
+ *      header line or as a JSON array, giving the median, extremes and
+ *      quartiles of the nanoseconds per pixel over the timed runs.
+ ************************/
+void Benchmark_run(FILE *fp, const struct Options *options)
+{
+        Pnm_ppm image = Pnm_ppmread(fp, uarray2_methods_plain);
+        CPUTime_T timer = CPUTime_New();
+        Perfcount_T counters = options->counters ? Perfcount_New() : NULL;
+        bool first = true;
+        const int *sizes = bench_blocksizes;
+        int nsizes = sizeof(bench_blocksizes) / sizeof(bench_blocksizes[0]);
+        if (options->blocksize > 0) {
+                sizes = &options->blocksize;
+                nsizes = 1;
+        }
+        int default_size = default_blocksize(pixel_size(options, 
+                                                        image->denominator));
+
+        if (options->format == FORMAT_CSV) {
+                printf("transform,traversal,blocksize,width,height,runs,"
+                       "median_ns,min_ns,max_ns,p25_ns,p75_ns");
+                for (int e = 0; e < PERFCOUNT_NEVENTS && options->counters;
+                     e++) {
+                        printf(",%s_per_pixel", Perfcount_names[e]);
+                }
+                printf("\n");
+        } else {
+                printf("[");
+        }
+        if (options->sweep_lo > 0) {
+                for (int blocksize = options->sweep_lo; 
+                     blocksize <= options->sweep_hi; 
+                     blocksize += options->sweep_step) {
+                        struct Bench_result result =
+                                bench_config(options, image, options->kind,
+                                             A2_BLOCK_MAJOR, blocksize,
+                                             timer, counters);
+                        write_bench_result(options, image, &result, first);
+                        first = false;
+                }
+        }
+        for (A2Transform_T kind = A2_ROTATE_0; 
+             kind <= A2_TRANSVERSE && options->sweep_lo == 0; kind++) {
+                for (A2Traversal_T order = A2_ROW_MAJOR;
+                     order <= A2_BLOCK_MAJOR; order++) {
+                        int n = order == A2_BLOCK_MAJOR ? nsizes : 1;
+                        for (int i = 0; i < n; i++) {
+                                if (sizes[0] == 0 && i > 0 
+                                    && sizes[i] == default_size) {
+                                        continue;
+                                }
+                                struct Bench_result result =
+                                        bench_config(options, image, kind,
+                                                     order, sizes[i], 
+                                                     timer, counters);
+                                write_bench_result(options, image, &result,
+                                                   first);
+                                first = false;
+                        }
+                }
+        }
+        if (options->format == FORMAT_JSON) {
+                printf("\n]\n");
+        }
+
+        CPUTime_Free(&timer);
+        if (counters != NULL) {
+                Perfcount_Free(&counters);
+        }
+        Pnm_ppmfree(&image);
+}
@@ -0,0 +1,27 @@
+/**************************************************************
+ *
+ *                     benchmark.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to ppmtrans's -benchmark mode, which times transforms
+ *     instead of writing an image.
+ *
+ **************************************************************/
+
+#ifndef BENCHMARK_INCLUDED
+#define BENCHMARK_INCLUDED
+
+#include <stdio.h>
+
+#include "ppmtrans.h"
+
+/*
+ * times the transforms, traversals and block sizes options asks for
+ * on the image in fp and writes a table of them to stdout
+ */
+extern void Benchmark_run(FILE *fp, const struct Options *options);
+
+#endif
@@ -0,0 +1,162 @@
+/**************************************************************
+ *
+ *                     cachedriver.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of ppmtrans's -cachesim mode, which runs one
+ *     transform through cachesim's model of the -cache levels, watching
+ *     the source and destination arrays through A2Watch, and reports
+ *     the hits and misses of each level.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "a2watch.h"
+#include "cachedriver.h"
+
+/* the caches -cachesim models when no -cache is given: a common 
+desktop's L1 data cache, L2 and last level cache */
+static const Cachesim_level default_caches[] = {
+        { 32 << 10, 8, 64 },
+        { 256 << 10, 8, 64 },
+        { 8 << 20, 16, 64 },
+};
+
+int Cachedriver_defaults(Cachesim_level caches[CACHESIM_MAX_LEVELS])
+{
+        int n = sizeof(default_caches) / sizeof(default_caches[0]);
+        memcpy(caches, default_caches, sizeof(default_caches));
+        return n;
+}
+
+/* how the report names the arrays */
+static const char *const array_names[] = {
+        [SOURCE] = "source", [DESTINATION] = "destination"
+};
+
+/* feeds each access to one of the two arrays to the simulator */
+static void simulate_access(const void *address, int bytes, 
+                            A2Watch_kind kind, int label, void *cl)
+{
+        (void)kind;
+        if (label >= 0) {
+                Cachesim_access(cl, address, bytes, label);
+        }
+}
+
+/* one row of the report: lookups and hits of one level, for one array 
+or, with array NARRAYS, both */
+static void write_cache_row(const struct Options *options, Pnm_ppm image,
+                            int blocksize, Cachesim_T sim, int level, 
+                            int array, bool first)
+{
+        const Cachesim_level *shape = &options->caches[level];
+        uint64_t lookups = 0, hits = 0;
+        for (int a = 0; a < NARRAYS; a++) {
+                if (array == NARRAYS || array == a) {
+                        lookups += Cachesim_lookups(sim, level, a);
+                        hits += Cachesim_hits(sim, level, a);
+                }
+        }
+        double miss_rate = lookups > 0 
+                           ? (double)(lookups - hits) / lookups : 0.0;
+        const char *name = array == NARRAYS ? "both" : array_names[array];
+        A2Traversal_T order = traversal_of(options->methods, options->map);
+
+        if (options->format == FORMAT_CSV) {
+                printf("%s,%s,%d,%u,%u,L%d,%zu,%d,%d,%s,%" PRIu64 ",%" 
+                       PRIu64 ",%" PRIu64 ",%.4f\n", 
+                       kind_names[options->kind], traversal_names[order],
+                       blocksize, image->width, image->height, level + 1,
+                       shape->size, shape->ways, shape->line, name, 
+                       lookups, hits, lookups - hits, miss_rate);
+                return;
+        }
+        printf("%s\n  {\"transform\": \"%s\", \"traversal\": \"%s\", "
+               "\"blocksize\": %d, \"width\": %u, \"height\": %u, "
+               "\"level\": \"L%d\", \"size\": %zu, \"ways\": %d, "
+               "\"line\": %d, \"array\": \"%s\", \"lookups\": %" PRIu64 
+               ", \"hits\": %" PRIu64 ", \"misses\": %" PRIu64 
+               ", \"miss_rate\": %.4f}", first ? "[" : ",", 
+               kind_names[options->kind], traversal_names[order], 
+               blocksize, image->width, image->height, level + 1, 
+               shape->size, shape->ways, shape->line, name, lookups, hits,
+               lookups - hits, miss_rate);
+}
+
+/********** Cachedriver_run ********
+ *
+ * Transforms the image in fp through a model of the -cache hierarchy 
+ * and reports the hits and misses of every level
+ *
+ * Parameters:
+ *      FILE *fp: the input image
+ *      const struct Options *options: the transform, suite, traversal,
+ *                                     block size, caches and format
+ *
+ * Return:
+ *      None
+ *
+ * Notes:
+ *      The transform runs through the per-pixel callbacks over an 
+ *      A2Watch wrapping of the suite, so every source cell the map 
+ *      passes and every destination cell at() returns goes through 
+ *      the model, in the order the per-pixel callbacks touch them.  
+ *      That only approximates the built-in kernels: quarter turns and 
+ *      the diagonals move 4 x 4 groups of cells, filled bottom-up, and 
+ *      flips and half turns reverse whole runs of a row at once.  Only
+ *      the pixels are modelled, not the arrays' own bookkeeping.
+ *      Writes a row per level and array (source, destination and 
+ *      both), as CSV with a header line or as a JSON array; no image 
+ *      is written.
+ ************************/
+void Cachedriver_run(FILE *fp, const struct Options *options)
+{
+        A2Methods_T methods = options->methods;
+        Pnm_ppm image = read_image(fp, options, NULL);
+        int blocksize = methods->blocksize(image->pixels);
+        int new_width, new_height;
+        A2Transform_dims(options->kind, image->width, image->height, 
+                         &new_width, &new_height);
+        A2 trans = methods->new_with_blocksize(new_width, new_height,
+                                               methods->size(image->pixels),
+                                               blocksize);
+
+        Cachesim_T sim = Cachesim_new(options->ncaches, options->caches, 
+                                      NARRAYS);
+        A2Methods_T watched = A2Watch_methods(methods, simulate_access, 
+                                              sim);
+        A2Watch_label(image->pixels, SOURCE);
+        A2Watch_label(trans, DESTINATION);
+        transform_into(watched, 
+                       map_of(watched, traversal_of(methods, options->map)),
+                       options->kind, image->pixels, trans);
+
+        if (options->format == FORMAT_CSV) {
+                printf("transform,traversal,blocksize,width,height,level,"
+                       "size,ways,line,array,lookups,hits,misses,"
+                       "miss_rate\n");
+        }
+        bool first = true;
+        for (int level = 0; level < options->ncaches; level++) {
+                for (int array = 0; array <= NARRAYS; array++) {
+                        write_cache_row(options, image, blocksize, sim, 
+                                        level, array, first);
+                        first = false;
+                }
+        }
+        if (options->format == FORMAT_JSON) {
+                printf("\n]\n");
+        }
+
+        Cachesim_free(&sim);
+        watched->free(&trans);
+        Pnm_ppmfree(&image);
+}
@@ -0,0 +1,35 @@
+/**************************************************************
+ *
+ *                     cachedriver.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to ppmtrans's -cachesim mode, which reports how a
+ *     transform would use a hierarchy of caches instead of writing an
+ *     image.
+ *
+ **************************************************************/
+
+#ifndef CACHEDRIVER_INCLUDED
+#define CACHEDRIVER_INCLUDED
+
+#include <stdio.h>
+
+#include "cachesim.h"
+#include "ppmtrans.h"
+
+/*
+ * fills caches with the levels -cachesim models when no -cache is
+ * given, and returns how many there are
+ */
+extern int Cachedriver_defaults(Cachesim_level caches[CACHESIM_MAX_LEVELS]);
+
+/*
+ * transforms the image in fp through a model of options->caches and
+ * writes the hits and misses of every level to stdout
+ */
+extern void Cachedriver_run(FILE *fp, const struct Options *options);
+
+#endif
@@ -0,0 +1,149 @@
+/**************************************************************
+ *
+ *                     cachesim.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the cache model.  Each level is an array of
+ *     sets, and each set keeps the numbers of the lines it holds most
+ *     recently used first, so a hit moves its line to the front and a
+ *     miss drops the last one.  Levels neither include nor exclude one
+ *     another: a line comes into every level that missed it and leaves
+ *     each one on that level's own evictions.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "assert.h"
+#include "cachesim.h"
+
+#define T Cachesim_T
+
+/* a way holding no line */
+#define EMPTY UINT64_MAX
+
+struct level {
+        int ways;
+        int line_shift;         /* log2 of the line size */
+        uint64_t nsets;
+        uint64_t *tags;         /* nsets * ways line numbers, each set
+                                   most recently used first */
+        uint64_t *lookups, *hits;       /* one per stream */
+};
+
+struct T {
+        int nlevels, nstreams;
+        struct level levels[CACHESIM_MAX_LEVELS];
+};
+
+T Cachesim_new(int nlevels, const Cachesim_level levels[], int nstreams)
+{
+        assert(nlevels >= 1 && nlevels <= CACHESIM_MAX_LEVELS);
+        assert(nstreams >= 1);
+        T sim = malloc(sizeof(*sim));
+        assert(sim != NULL);
+        sim->nlevels = nlevels;
+        sim->nstreams = nstreams;
+
+        for (int l = 0; l < nlevels; l++) {
+                const Cachesim_level *shape = &levels[l];
+                struct level *level = &sim->levels[l];
+                assert(shape->ways >= 1 && shape->line >= 1);
+                assert((shape->line & (shape->line - 1)) == 0);
+                size_t set_bytes = (size_t)shape->ways * shape->line;
+                assert(shape->size >= set_bytes);
+
+                level->ways = shape->ways;
+                level->line_shift = 0;
+                while ((1 << level->line_shift) < shape->line) {
+                        level->line_shift++;
+                }
+                level->nsets = shape->size / set_bytes;
+                level->tags = malloc(level->nsets * level->ways
+                                     * sizeof(*level->tags));
+                level->lookups = calloc(nstreams, sizeof(*level->lookups));
+                level->hits = calloc(nstreams, sizeof(*level->hits));
+                assert(level->tags != NULL && level->lookups != NULL
+                       && level->hits != NULL);
+                for (uint64_t i = 0; i < level->nsets * level->ways; i++) {
+                        level->tags[i] = EMPTY;
+                }
+        }
+        return sim;
+}
+
+void Cachesim_free(T *sim)
+{
+        assert(sim != NULL && *sim != NULL);
+        for (int l = 0; l < (*sim)->nlevels; l++) {
+                free((*sim)->levels[l].tags);
+                free((*sim)->levels[l].lookups);
+                free((*sim)->levels[l].hits);
+        }
+        free(*sim);
+        *sim = NULL;
+}
+
+/* looks for the line holding byte address in level, making it the most
+recently used line of its set either way; true if it was there */
+static bool touch(struct level *level, uint64_t address)
+{
+        uint64_t line = address >> level->line_shift;
+        uint64_t *set = level->tags + (line % level->nsets) * level->ways;
+
+        int way = 0;
+        while (way < level->ways - 1 && set[way] != line) {
+                way++;
+        }
+        bool hit = set[way] == line;
+        memmove(set + 1, set, way * sizeof(*set));
+        set[0] = line;
+        return hit;
+}
+
+void Cachesim_access(T sim, const void *address, size_t bytes, int stream)
+{
+        assert(sim != NULL);
+        assert(stream >= 0 && stream < sim->nstreams);
+        if (bytes == 0) {
+                return;
+        }
+        uint64_t first = (uintptr_t)address;
+        uint64_t last = first + bytes - 1;
+
+        /* each level 0 line is looked for as far down as it has to go */
+        int shift = sim->levels[0].line_shift;
+        for (uint64_t line = first >> shift; line <= last >> shift; line++) {
+                for (int l = 0; l < sim->nlevels; l++) {
+                        struct level *level = &sim->levels[l];
+                        level->lookups[stream]++;
+                        if (touch(level, line << shift)) {
+                                level->hits[stream]++;
+                                break;
+                        }
+                }
+        }
+}
+
+uint64_t Cachesim_lookups(T sim, int level, int stream)
+{
+        assert(sim != NULL);
+        assert(level >= 0 && level < sim->nlevels);
+        assert(stream >= 0 && stream < sim->nstreams);
+        return sim->levels[level].lookups[stream];
+}
+
+uint64_t Cachesim_hits(T sim, int level, int stream)
+{
+        assert(sim != NULL);
+        assert(level >= 0 && level < sim->nlevels);
+        assert(stream >= 0 && stream < sim->nstreams);
+        return sim->levels[level].hits[stream];
+}
+
+#undef T
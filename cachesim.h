@@ -0,0 +1,61 @@
+/**************************************************************
+ *
+ *                     cachesim.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to a model of a cache hierarchy.  It is given the
+ *     addresses a program touches and counts the hits and misses each
+ *     level of a machine's caches would have had, kept apart by
+ *     stream (which array an access belongs to, say), so the locality
+ *     of a traversal can be judged on a box without the caches, or
+ *     the counters, of the machine it is meant for.
+ *
+ **************************************************************/
+
+#ifndef CACHESIM_INCLUDED
+#define CACHESIM_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define T Cachesim_T
+typedef struct T *T;
+
+#define CACHESIM_MAX_LEVELS 4
+
+/* the shape of one level: size / (ways * line) sets of 'ways' lines */
+typedef struct Cachesim_level {
+        size_t size;            /* bytes */
+        int ways;               /* associativity */
+        int line;               /* bytes in a line, a power of two */
+} Cachesim_level;
+
+/*
+ * a hierarchy of nlevels caches, level 0 nearest the processor, all
+ * empty, counting nstreams streams.  Every level must hold at least
+ * one set, with a line of a power of two no bigger than the level
+ * (checked runtime errors)
+ */
+extern T Cachesim_new(int nlevels, const Cachesim_level levels[],
+                      int nstreams);
+
+extern void Cachesim_free(T *sim);
+
+/*
+ * one access of 'bytes' bytes at address for stream, which touches
+ * every line those bytes lie in.  Each line is looked for level by
+ * level until a level has it; every level that missed then gets it,
+ * evicting its least recently used line if the set is full
+ */
+extern void Cachesim_access(T sim, const void *address, size_t bytes,
+                            int stream);
+
+/* line lookups at level for stream, and how many of them hit */
+extern uint64_t Cachesim_lookups(T sim, int level, int stream);
+extern uint64_t Cachesim_hits(T sim, int level, int stream);
+
+#undef T
+#endif
@@ -52,6 +52,21 @@ CPUTime_T CPUTime_New()
 {
         CPUTime_T startTimep = malloc(sizeof(*startTimep));
         assert (startTimep != NULL);
+        startTimep->clock = CLOCK_PROCESS_CPUTIME_ID;
+        return startTimep;
+}
+
+CPUTime_T CPUTime_NewThread()
+{
+        CPUTime_T startTimep = CPUTime_New();
+        startTimep->clock = CLOCK_THREAD_CPUTIME_ID;
+        return startTimep;
+}
+
+CPUTime_T CPUTime_NewWall()
+{
+        CPUTime_T startTimep = CPUTime_New();
+        startTimep->clock = CLOCK_MONOTONIC;
         return startTimep;
 }
 
@@ -66,14 +81,14 @@ void CPUTime_Free(CPUTime_T *startTimepp)
 
 void CPUTime_Start(CPUTime_T startTimep)
 {
-        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &(startTimep->time));
+        clock_gettime(startTimep->clock, &(startTimep->time));
         return;
 }
 
 double CPUTime_Stop(CPUTime_T startTimep)
 {
         struct timespec stop, time_used;
-        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &stop);
+        clock_gettime(startTimep->clock, &stop);
         assert(timespec_subtract(&time_used, &stop, &(startTimep->time)) == 0);
         return timespec_to_double(&time_used);
 }
@@ -44,6 +44,14 @@ typedef struct CPU_Time *CPUTime_T;
 
 CPUTime_T CPUTime_New();
 
+/* like CPUTime_New, but measures only the CPU time of the thread that
+ * calls CPUTime_Start and CPUTime_Stop, not of the whole process */
+CPUTime_T CPUTime_NewThread();
+
+/* like CPUTime_New, but measures elapsed real (wall-clock) time, which
+ * includes time spent waiting for I/O */
+CPUTime_T CPUTime_NewWall();
+
 void CPUTime_Free(CPUTime_T *startTimepp);
 
 void CPUTime_Start(CPUTime_T StartTimep) ;
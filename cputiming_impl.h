@@ -33,4 +33,6 @@
 
 struct CPU_Time {
         struct timespec time;
+        clockid_t clock;        /* whose CPU time, or wall time, is 
+                                   measured */
 };
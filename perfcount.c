@@ -0,0 +1,184 @@
+/**************************************************************
+ *
+ *                     perfcount.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the hardware event counters on Linux's
+ *     perf_event_open.  Each event is opened on its own rather than as
+ *     a group, so that one the processor lacks (dTLB misses are often
+ *     missing under virtualisation) does not take the others with it.
+ *     Only user-space events are counted, which is all an unprivileged
+ *     process is usually allowed.  Elsewhere than Linux every event is
+ *     unavailable.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "assert.h"
+#include "perfcount.h"
+
+#define T Perfcount_T
+
+const char *const Perfcount_names[PERFCOUNT_NEVENTS] = {
+        [PERFCOUNT_CYCLES]       = "cycles",
+        [PERFCOUNT_INSTRUCTIONS] = "instructions",
+        [PERFCOUNT_L1D_MISSES]   = "l1d_misses",
+        [PERFCOUNT_LLC_MISSES]   = "llc_misses",
+        [PERFCOUNT_DTLB_MISSES]  = "dtlb_misses",
+};
+
+struct T {
+        int fds[PERFCOUNT_NEVENTS];     /* -1 where unavailable */
+};
+
+#if defined(__linux__)
+
+/* a cache event: which cache, a read, and whether it missed */
+#define CACHE_READ_MISS(cache) ((cache) \
+                                | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+                                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+        uint32_t type;
+        uint64_t config;
+} events[PERFCOUNT_NEVENTS] = {
+        [PERFCOUNT_CYCLES]       = { PERF_TYPE_HARDWARE,
+                                     PERF_COUNT_HW_CPU_CYCLES },
+        [PERFCOUNT_INSTRUCTIONS] = { PERF_TYPE_HARDWARE,
+                                     PERF_COUNT_HW_INSTRUCTIONS },
+        [PERFCOUNT_L1D_MISSES]   = { PERF_TYPE_HW_CACHE,
+                                     CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+        [PERFCOUNT_LLC_MISSES]   = { PERF_TYPE_HARDWARE,
+                                     PERF_COUNT_HW_CACHE_MISSES },
+        [PERFCOUNT_DTLB_MISSES]  = { PERF_TYPE_HW_CACHE,
+                                     CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB) },
+};
+
+/* what reading a counter gives, with the read_format asked for below */
+struct reading {
+        uint64_t value, time_enabled, time_running;
+};
+
+/* a disabled counter of event for this thread and its later children,
+or -1 if the system will not give one */
+static int open_event(Perfcount_event event)
+{
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[event].type;
+        attr.config = events[event].config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                           | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        return fd < 0 ? -1 : (int)fd;
+}
+
+#else
+
+static int open_event(Perfcount_event event)
+{
+        (void)event;
+        return -1;
+}
+
+#endif
+
+T Perfcount_New(void)
+{
+        T counters = malloc(sizeof(*counters));
+        assert(counters != NULL);
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                counters->fds[e] = open_event(e);
+        }
+        return counters;
+}
+
+void Perfcount_Free(T *counters)
+{
+        assert(counters != NULL && *counters != NULL);
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                if ((*counters)->fds[e] >= 0) {
+                        close((*counters)->fds[e]);
+                }
+        }
+        free(*counters);
+        *counters = NULL;
+}
+
+bool Perfcount_available(T counters, Perfcount_event event)
+{
+        assert(counters != NULL);
+        assert(event < PERFCOUNT_NEVENTS);
+        return counters->fds[event] >= 0;
+}
+
+bool Perfcount_any(T counters)
+{
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                if (Perfcount_available(counters, e)) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+void Perfcount_Start(T counters)
+{
+        assert(counters != NULL);
+#if defined(__linux__)
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                if (counters->fds[e] >= 0) {
+                        ioctl(counters->fds[e], PERF_EVENT_IOC_RESET, 0);
+                        ioctl(counters->fds[e], PERF_EVENT_IOC_ENABLE, 0);
+                }
+        }
+#endif
+}
+
+void Perfcount_Stop(T counters, uint64_t counts[PERFCOUNT_NEVENTS])
+{
+        assert(counters != NULL && counts != NULL);
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                counts[e] = 0;
+        }
+#if defined(__linux__)
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                if (counters->fds[e] >= 0) {
+                        ioctl(counters->fds[e], PERF_EVENT_IOC_DISABLE, 0);
+                }
+        }
+        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                struct reading r;
+                if (counters->fds[e] < 0
+                    || read(counters->fds[e], &r, sizeof(r))
+                       != (ssize_t)sizeof(r)
+                    || r.time_running == 0) {
+                        continue;
+                }
+                counts[e] = r.time_running < r.time_enabled
+                            ? (uint64_t)((double)r.value * r.time_enabled
+                                         / r.time_running)
+                            : r.value;
+        }
+#endif
+}
+
+#undef T
@@ -0,0 +1,67 @@
+/**************************************************************
+ *
+ *                     perfcount.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to the hardware event counters, the companion of
+ *     cputiming.h for what the time alone does not show: cycles,
+ *     instructions and the cache and TLB misses that decide which
+ *     traversal is fastest.  A Perfcount_T is used like a CPUTime_T,
+ *     started and stopped around the work to be measured.  Where the
+ *     kernel, the hardware or a container does not allow an event, it
+ *     is simply not available, and counting the rest goes on; nothing
+ *     here ever fails for want of counters.
+ *
+ **************************************************************/
+
+#ifndef PERFCOUNT_INCLUDED
+#define PERFCOUNT_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define T Perfcount_T
+typedef struct T *T;
+
+/* the events counted */
+typedef enum Perfcount_event {
+        PERFCOUNT_CYCLES,
+        PERFCOUNT_INSTRUCTIONS,
+        PERFCOUNT_L1D_MISSES,   /* level 1 data cache read misses */
+        PERFCOUNT_LLC_MISSES,   /* last level cache misses */
+        PERFCOUNT_DTLB_MISSES,  /* data TLB read misses */
+        PERFCOUNT_NEVENTS
+} Perfcount_event;
+
+/* short names for output, such as "cycles" and "l1d_misses" */
+extern const char *const Perfcount_names[PERFCOUNT_NEVENTS];
+
+/*
+ * counters for the calling thread and any threads it starts from now
+ * on; the events the system refuses are left unavailable
+ */
+extern T Perfcount_New(void);
+
+extern void Perfcount_Free(T *counters);
+
+/* true if the event is being counted */
+extern bool Perfcount_available(T counters, Perfcount_event event);
+
+/* true if any event is */
+extern bool Perfcount_any(T counters);
+
+/* zeroes the counters and starts them */
+extern void Perfcount_Start(T counters);
+
+/*
+ * stops the counters and puts the count of each event since
+ * Perfcount_Start in counts, scaled up for any time the kernel had it
+ * switched off to share the hardware; an unavailable event counts 0
+ */
+extern void Perfcount_Stop(T counters, uint64_t counts[PERFCOUNT_NEVENTS]);
+
+#undef T
+#endif
@@ -0,0 +1,174 @@
+/**************************************************************
+ *
+ *                     phases.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of -phases timing.  Each phase keeps running totals
+ *     of wall-clock and CPU nanoseconds, and with -counters of hardware
+ *     events, so a phase entered several times in one run (parsing before
+ *     and after allocation, say) is reported once.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "phases.h"
+#include "ppmtrans.h"
+
+static const char *const phase_names[] = {
+        [PHASE_OPEN]      = "open",
+        [PHASE_PARSE]     = "parse",
+        [PHASE_ALLOC]     = "alloc",
+        [PHASE_TRANSFORM] = "transform",
+        [PHASE_WRITE]     = "write",
+        [PHASE_FREE]      = "free",
+};
+
+/* zeroes every total of phases */
+void Phases_reset(struct Phases *phases)
+{
+        memset(phases->wall_ns, 0, sizeof(phases->wall_ns));
+        memset(phases->cpu_ns, 0, sizeof(phases->cpu_ns));
+        memset(phases->counts, 0, sizeof(phases->counts));
+}
+
+/* sets up phases with every total at zero; thread is true if only the 
+calling thread's CPU time should count, as for a batch worker.  The 
+counters follow the calling thread, so phases must be set up on the 
+thread it will time */
+void Phases_init(struct Phases *phases, bool thread, bool counters)
+{
+        phases->wall = CPUTime_NewWall();
+        phases->cpu = thread ? CPUTime_NewThread() : CPUTime_New();
+        phases->counters = counters ? Perfcount_New() : NULL;
+        Phases_reset(phases);
+}
+
+void Phases_free(struct Phases *phases)
+{
+        CPUTime_Free(&phases->wall);
+        CPUTime_Free(&phases->cpu);
+        if (phases->counters != NULL) {
+                Perfcount_Free(&phases->counters);
+        }
+}
+
+/* Phases_start and Phases_stop bracket the work of one phase, which is 
+added to that phase's totals; both do nothing when phases is NULL, 
+which is how a run without -phases goes */
+void Phases_start(struct Phases *phases)
+{
+        if (phases != NULL) {
+                CPUTime_Start(phases->wall);
+                CPUTime_Start(phases->cpu);
+                if (phases->counters != NULL) {
+                        Perfcount_Start(phases->counters);
+                }
+        }
+}
+
+void Phases_stop(struct Phases *phases, enum Phase phase)
+{
+        if (phases != NULL) {
+                if (phases->counters != NULL) {
+                        uint64_t counts[PERFCOUNT_NEVENTS];
+                        Perfcount_Stop(phases->counters, counts);
+                        for (int e = 0; e < PERFCOUNT_NEVENTS; e++) {
+                                phases->counts[phase][e] += counts[e];
+                        }
+                }
+                phases->cpu_ns[phase] += CPUTime_Stop(phases->cpu);
+                phases->wall_ns[phase] += CPUTime_Stop(phases->wall);
+        }
+}
+
+/* writes text as a JSON string, or null if it is NULL */
+static void write_json_string(FILE *fp, const char *text)
+{
+        if (text == NULL) {
+                fputs("null", fp);
+                return;
+        }
+        putc('"', fp);
+        for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+                if (*c == '"' || *c == '\\') {
+                        fprintf(fp, "\\%c", *c);
+                } else if (*c < 0x20) {
+                        fprintf(fp, "\\u%04x", *c);
+                } else {
+                        putc(*c, fp);
+                }
+        }
+        putc('"', fp);
+}
+
+/********** Phases_write ********
+ *
+ * Appends one run's phase times to the -phases file as a line of JSON
+ *
+ * Parameters:
+ *      const struct Options *options: the file name and the transform
+ *      const struct Phases *phases: the times
+ *      const char *path: the input file, NULL for stdin
+ *      const char *suite: "plain", "blocked" or "stream"
+ *      int blocksize: of the arrays, 0 if there were none
+ *      int width, height: of the image the transform was given
+ *
+ * Return: 
+ *      None
+ *
+ * Notes:
+ *      The line is an object holding the image and output dimensions,
+ *      the suite, block size, transform ("affine" for -angle and 
+ *      -affine), scale and thread count, and a "phases" object giving 
+ *      wall_ns and cpu_ns for each phase.  With -counters each phase 
+ *      also has a count of every hardware event, null for those the 
+ *      system would not count.
+ ************************/
+void Phases_write(const struct Options *options, 
+                  const struct Phases *phases, const char *path,
+                  const char *suite, int blocksize, int width, 
+                  int height)
+{
+        FILE *fp = fopen(options->phases_file_name, "a");
+        if (fp == NULL) {
+                perror("Error opening file");
+                return;
+        }
+        int new_width, new_height;
+        result_dims(options, width, height, &new_width, &new_height);
+
+        fputs("{\"file\": ", fp);
+        write_json_string(fp, path);
+        fprintf(fp, ", \"width\": %d, \"height\": %d, \"new_width\": %d, "
+                "\"new_height\": %d, \"methods\": \"%s\", "
+                "\"blocksize\": %d, \"transform\": \"%s\", \"scale\": %d, "
+                "\"threads\": %d, \"phases\": {", width, height, new_width,
+                new_height, suite, blocksize, 
+                options->warp ? "affine" : kind_names[options->kind],
+                options->scale, options->threads);
+        for (int p = 0; p < NPHASES; p++) {
+                fprintf(fp, "%s\"%s\": {\"wall_ns\": %.0f, "
+                        "\"cpu_ns\": %.0f", p == 0 ? "" : ", ", 
+                        phase_names[p], phases->wall_ns[p], 
+                        phases->cpu_ns[p]);
+                for (int e = 0; e < PERFCOUNT_NEVENTS 
+                                && phases->counters != NULL; e++) {
+                        fprintf(fp, ", \"%s\": ", Perfcount_names[e]);
+                        if (Perfcount_available(phases->counters, e)) {
+                                fprintf(fp, "%" PRIu64, 
+                                        phases->counts[p][e]);
+                        } else {
+                                fputs("null", fp);
+                        }
+                }
+                putc('}', fp);
+        }
+        fputs("}}\n", fp);
+        fclose(fp);
+}
@@ -0,0 +1,72 @@
+/**************************************************************
+ *
+ *                     phases.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Interface to -phases timing: where the time of one run goes, split
+ *     into opening, parsing, allocating, transforming, writing and freeing
+ *     and measured by the wall clock and the CPU, with hardware event
+ *     counts under -counters.  Each run appends a line of JSON to the
+ *     -phases file.
+ *
+ **************************************************************/
+
+#ifndef PHASES_INCLUDED
+#define PHASES_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cputiming.h"
+#include "perfcount.h"
+
+/* the parts of a run -phases times separately, in the order they 
+happen */
+enum Phase {
+        PHASE_OPEN, PHASE_PARSE, PHASE_ALLOC, PHASE_TRANSFORM, PHASE_WRITE,
+        PHASE_FREE, NPHASES
+};
+
+/* the wall-clock and CPU nanoseconds spent in each phase of one run, 
+and with -counters the hardware events */
+struct Phases {
+        CPUTime_T wall, cpu;
+        Perfcount_T counters;   /* NULL without -counters */
+        double wall_ns[NPHASES], cpu_ns[NPHASES];
+        uint64_t counts[NPHASES][PERFCOUNT_NEVENTS];
+};
+
+struct Options;
+
+/*
+ * sets up phases with every total at zero; thread is true if only the
+ * calling thread's CPU time should count.  Must be called on the
+ * thread phases will time
+ */
+extern void Phases_init(struct Phases *phases, bool thread, bool counters);
+
+/* zeroes every total, for the next run */
+extern void Phases_reset(struct Phases *phases);
+
+extern void Phases_free(struct Phases *phases);
+
+/*
+ * bracket the work of one phase, which is added to its totals; both do
+ * nothing when phases is NULL
+ */
+extern void Phases_start(struct Phases *phases);
+extern void Phases_stop(struct Phases *phases, enum Phase phase);
+
+/*
+ * appends the totals of a run of the transform in options on a
+ * width x height image to the -phases file, as one line of JSON
+ */
+extern void Phases_write(const struct Options *options,
+                         const struct Phases *phases, const char *path,
+                         const char *suite, int blocksize, int width,
+                         int height);
+
+#endif
@@ -0,0 +1,1030 @@
+/**************************************************************
+ *
+ *                     ppmstream.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Implementation of the P6 row reader and writer in ppmstream.h,
+ *     and of the transforms that can run on a stream of rows.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "assert.h"
+#include "pnm.h"
+#include "ppmstream.h"
+
+#define T Ppmstream_T
+
+struct T {
+        FILE *fp;
+        unsigned width, height, denominator;
+        int pixel_size;
+        size_t row_size;
+        unsigned rows_read;
+        size_t stride;          /* bytes per row in the file */
+        size_t skip;            /* bytes before the crop in each */
+        char *line;             /* a whole file row, when cropping cols */
+        bool lenient;           /* from Ppmstream_try_open */
+        bool truncated;         /* a lenient stream ran out of raster */
+};
+
+/*****************************************************************
+ *                        Reading and writing
+ *****************************************************************/
+
+/* skips whitespace and comments, then reads one unsigned decimal number
+ * into *n; false if there is none, or it is too big */
+static bool read_header_number(FILE *fp, unsigned *n)
+{
+        int c = getc(fp);
+        while (isspace(c) || c == '#') {
+                if (c == '#') {
+                        while (c != '\n' && c != EOF) {
+                                c = getc(fp);
+                        }
+                }
+                c = getc(fp);
+        }
+        if (!isdigit(c)) {
+                return false;
+        }
+
+        unsigned long value = 0;
+        while (isdigit(c)) {
+                value = value * 10 + (c - '0');
+                if (value > 0xffffffffUL) {
+                        return false;
+                }
+                c = getc(fp);
+        }
+        *n = value;
+        /* the one whitespace byte after a number belongs to the header */
+        return isspace(c);
+}
+
+/* the stream for the P6 header at the start of fp, or NULL if there is
+ * not one there; with magic_read, fp is just past its magic number, 
+ * which Ppmstream_read_magic found to be P6 */
+static T open_stream(FILE *fp, bool lenient, bool magic_read)
+{
+        int p = magic_read ? 'P' : getc(fp);
+        int six = magic_read ? '6' : getc(fp);
+        unsigned width, height, denominator;
+        if (p != 'P' || six != '6' || !read_header_number(fp, &width)
+            || !read_header_number(fp, &height)
+            || !read_header_number(fp, &denominator)
+            || width == 0 || height == 0 
+            || denominator == 0 || denominator > 65535) {
+                return NULL;
+        }
+
+        T stream = malloc(sizeof(*stream));
+        assert(stream != NULL);
+
+        stream->fp = fp;
+        stream->width = width;
+        stream->height = height;
+        stream->denominator = denominator;
+        stream->pixel_size = denominator > 255 ? 6 : 3;
+        stream->row_size = (size_t)width * stream->pixel_size;
+        stream->rows_read = 0;
+        stream->stride = stream->row_size;
+        stream->skip = 0;
+        stream->line = NULL;
+        stream->lenient = lenient;
+        stream->truncated = false;
+        return stream;
+}
+
+/********** Ppmstream_open ********
+ *
+ * Parameters:
+ *      FILE *fp: an open binary PPM
+ *
+ * Return:
+ *      a stream positioned at the first row of the raster
+ *
+ * Expects:
+ *      fp is not NULL and starts with a valid P6 header (checked runtime
+ *      error)
+ ************************/
+T Ppmstream_open(FILE *fp)
+{
+        assert(fp != NULL);
+        T stream = open_stream(fp, false, false);
+        assert(stream != NULL);
+        return stream;
+}
+
+/* Ppmstream_open of an fp whose magic number Ppmstream_read_magic has 
+ * read, and found to be P6 */
+T Ppmstream_open_after_magic(FILE *fp)
+{
+        assert(fp != NULL);
+        T stream = open_stream(fp, false, true);
+        assert(stream != NULL);
+        return stream;
+}
+
+/********** Ppmstream_try_open ********
+ *
+ * Parameters:
+ *      FILE *fp: an open file that may or may not be a binary PPM
+ *
+ * Return:
+ *      a stream positioned at the first row of the raster, or NULL if
+ *      fp does not start with a valid P6 header
+ *
+ * Notes:
+ *      A raster that ends early is not an error for this stream: the 
+ *      missing bytes read as zero, and Ppmstream_truncated says so 
+ *      afterwards.  That is what lets one bad file of many be skipped.
+ ************************/
+T Ppmstream_try_open(FILE *fp)
+{
+        assert(fp != NULL);
+        return open_stream(fp, true, false);
+}
+
+/* Ppmstream_try_open of an fp whose magic number Ppmstream_read_magic 
+ * has read, and found to be P6 */
+T Ppmstream_try_open_after_magic(FILE *fp)
+{
+        assert(fp != NULL);
+        return open_stream(fp, true, true);
+}
+
+/********** Ppmstream_read_magic ********
+ *
+ * Parameters:
+ *      FILE *fp: an open file, nothing of which has been read
+ *
+ * Return:
+ *      the character after the P of a PPM magic number, such as '6' for
+ *      a P6 or '3' for a P3, with both bytes read; EOF if the file 
+ *      ends after the P; 0 if the file does not start with a P, in 
+ *      which case nothing has been read
+ *
+ * Notes:
+ *      Only the one byte C promises is ever pushed back.  After a P6 
+ *      the header goes on with Ppmstream_open_after_magic; any other 
+ *      magic number is put back for Pnm_ppmread by 
+ *      Ppmstream_unread_magic.
+ ************************/
+int Ppmstream_read_magic(FILE *fp)
+{
+        assert(fp != NULL);
+        int p = getc(fp);
+        if (p != 'P') {
+                if (p != EOF) {
+                        int pushed = ungetc(p, fp) == p;
+                        assert(pushed);
+                        (void)pushed;
+                }
+                return 0;
+        }
+        return getc(fp);
+}
+
+/********** Ppmstream_unread_magic ********
+ *
+ * Parameters:
+ *      FILE *fp: a file whose magic number Ppmstream_read_magic has 
+ *                just read
+ *      int magic: what Ppmstream_read_magic returned
+ *
+ * Return:
+ *      a file that starts over from the magic number: fp itself, 
+ *      moved back, if it can seek; otherwise a temporary copy of the
+ *      magic number and the rest of fp, which has been read to its end
+ *      and is the caller's to close as well
+ ************************/
+FILE *Ppmstream_unread_magic(FILE *fp, int magic)
+{
+        assert(fp != NULL);
+        if (magic == 0) {
+                return fp;
+        }
+        long read = magic == EOF ? 1 : 2;
+        if (fseek(fp, -read, SEEK_CUR) == 0) {
+                return fp;
+        }
+
+        FILE *copy = tmpfile();
+        assert(copy != NULL);
+        putc('P', copy);
+        if (magic != EOF) {
+                putc(magic, copy);
+        }
+        char buffer[BUFSIZ];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+                size_t written = fwrite(buffer, 1, n, copy);
+                assert(written == n);
+                (void)written;
+        }
+        rewind(copy);
+        return copy;
+}
+
+bool Ppmstream_truncated(T stream)
+{
+        assert(stream != NULL);
+        return stream->truncated;
+}
+
+/* reads size bytes into buf; on a lenient stream a short read zeroes
+ * the rest and marks the stream truncated rather than failing */
+static void read_raster(T stream, void *buf, size_t size)
+{
+        size_t got = fread(buf, 1, size, stream->fp);
+        if (got < size) {
+                assert(stream->lenient);
+                memset((char *)buf + got, 0, size - got);
+                stream->truncated = true;
+        }
+}
+
+void Ppmstream_free(T *stream)
+{
+        assert(stream != NULL && *stream != NULL);
+        free((*stream)->line);
+        free(*stream);
+        *stream = NULL;
+}
+
+unsigned Ppmstream_width(T stream)
+{
+        assert(stream != NULL);
+        return stream->width;
+}
+
+unsigned Ppmstream_height(T stream)
+{
+        assert(stream != NULL);
+        return stream->height;
+}
+
+unsigned Ppmstream_denominator(T stream)
+{
+        assert(stream != NULL);
+        return stream->denominator;
+}
+
+int Ppmstream_pixel_size(T stream)
+{
+        assert(stream != NULL);
+        return stream->pixel_size;
+}
+
+size_t Ppmstream_row_size(T stream)
+{
+        assert(stream != NULL);
+        return stream->row_size;
+}
+
+void Ppmstream_read_row(T stream, void *row)
+{
+        assert(stream != NULL && row != NULL);
+        assert(stream->rows_read < stream->height);
+
+        if (stream->line == NULL) {
+                read_raster(stream, row, stream->row_size);
+        } else {
+                read_raster(stream, stream->line, stream->stride);
+                memcpy(row, stream->line + stream->skip, stream->row_size);
+        }
+        stream->rows_read++;
+}
+
+/********** Ppmstream_crop ********
+ *
+ * Parameters:
+ *      T stream: a stream no rows of which have been read yet
+ *      unsigned x, y: the top left pixel of the crop
+ *      unsigned width, height: its size, at least 1 x 1
+ *
+ * Expects:
+ *      the crop lies inside the image (checked runtime error)
+ *
+ * Notes:
+ *      The rows above the crop are skipped at once, with a seek when
+ *      the input is a regular file, and the rows below it are never
+ *      read.  Rows that lose columns are read whole into one spare row
+ *      and only their middle is handed out.
+ ************************/
+void Ppmstream_crop(T stream, unsigned x, unsigned y, unsigned width,
+                    unsigned height)
+{
+        assert(stream != NULL && stream->rows_read == 0);
+        assert(width > 0 && height > 0);
+        assert(x < stream->width && width <= stream->width - x);
+        assert(y < stream->height && height <= stream->height - y);
+
+        size_t stride = stream->stride;
+        if (y > 0 && fseeko(stream->fp, (off_t)y * stride, SEEK_CUR) != 0) {
+                char *discard = malloc(stride);
+                assert(discard != NULL);
+                for (unsigned row = 0; row < y; row++) {
+                        read_raster(stream, discard, stride);
+                }
+                free(discard);
+        }
+
+        stream->width = width;
+        stream->height = height;
+        stream->row_size = (size_t)width * stream->pixel_size;
+        stream->skip = (size_t)x * stream->pixel_size;
+        if (stream->row_size != stride) {
+                stream->line = malloc(stride);
+                assert(stream->line != NULL);
+        }
+}
+
+void Ppmstream_write_header(FILE *out, unsigned width, unsigned height,
+                            unsigned denominator)
+{
+        assert(out != NULL);
+        fprintf(out, "P6\n%u %u\n%u\n", width, height, denominator);
+}
+
+void Ppmstream_write(FILE *out, const void *bytes, size_t size)
+{
+        assert(out != NULL);
+        size_t put = fwrite(bytes, 1, size, out);
+        assert(put == size);
+}
+
+/*
+ * the cells of one row of an array, found a contiguous run at a time:
+ * a whole row of a plain array, one block's row of a blocked one, or a
+ * single cell through methods->at for any other suite
+ */
+struct row_cells {
+        A2Methods_T methods;
+        A2Methods_UArray2 pixels;
+        A2Layout layout;
+        bool raw;
+        int width, size, row, col, run;
+        char *cell;
+};
+
+static void row_cells_init(struct row_cells *cells, A2Methods_T methods,
+                           A2Methods_UArray2 pixels)
+{
+        cells->methods = methods;
+        cells->pixels = pixels;
+        cells->raw = A2Layout_of(methods, pixels, &cells->layout);
+        cells->width = methods->width(pixels);
+        cells->size = methods->size(pixels);
+}
+
+/* the next row_cells_next is the first cell of 'row' */
+static void row_cells_seek(struct row_cells *cells, int row)
+{
+        cells->row = row;
+        cells->col = 0;
+        cells->run = 0;
+}
+
+static inline void *row_cells_next(struct row_cells *cells)
+{
+        if (cells->run == 0) {
+                int bs = cells->raw ? cells->layout.blocksize : 1;
+                cells->run = bs == 1 && cells->raw
+                             ? cells->width - cells->col
+                             : bs - cells->col % bs;
+                cells->cell = cells->raw
+                              ? A2Layout_at(&cells->layout, cells->col,
+                                            cells->row)
+                              : cells->methods->at(cells->pixels, 
+                                                   cells->col, cells->row);
+        }
+
+        void *pixel = cells->cell;
+        cells->cell += cells->size;
+        cells->col++;
+        cells->run--;
+        return pixel;
+}
+
+/* true if an array with cells of 'size' bytes holds packed pixels; any
+ * size but the two pixel sizes is a checked run-time error */
+static bool is_packed(int size)
+{
+        assert(size == sizeof(struct Pnm_rgb)
+               || size == sizeof(struct Ppmstream_rgb8));
+        return size == sizeof(struct Ppmstream_rgb8);
+}
+
+/********** Ppmstream_read_pixels ********
+ *
+ * Parameters:
+ *      T stream: the input, no rows of which have been read yet
+ *      A2Methods_T methods: the suite that made pixels
+ *      A2Methods_UArray2 pixels: filled with the image
+ *
+ * Expects:
+ *      pixels has the stream's width and height, and struct Pnm_rgb
+ *      cells or, with a denominator of at most PPMSTREAM_PACKED_MAX,
+ *      struct Ppmstream_rgb8 cells (checked runtime error)
+ *
+ * Notes:
+ *      A packed pixel is the three raster bytes and a zero, so those
+ *      rows are copied over with no decoding at all.
+ ************************/
+void Ppmstream_read_pixels(T stream, A2Methods_T methods,
+                           A2Methods_UArray2 pixels)
+{
+        assert(stream != NULL && methods != NULL && pixels != NULL);
+        assert(stream->rows_read == 0);
+        assert((unsigned)methods->width(pixels) == stream->width);
+        assert((unsigned)methods->height(pixels) == stream->height);
+        bool packed = is_packed(methods->size(pixels));
+        assert(!packed || stream->denominator <= PPMSTREAM_PACKED_MAX);
+
+        unsigned char *raw = malloc(stream->row_size);
+        assert(raw != NULL);
+        struct row_cells cells;
+        row_cells_init(&cells, methods, pixels);
+
+        for (unsigned row = 0; row < stream->height; row++) {
+                Ppmstream_read_row(stream, raw);
+                row_cells_seek(&cells, row);
+
+                const unsigned char *from = raw;
+                for (unsigned col = 0; col < stream->width; col++) {
+                        if (packed) {
+                                Ppmstream_rgb8 pixel = row_cells_next(&cells);
+                                pixel->red   = from[0];
+                                pixel->green = from[1];
+                                pixel->blue  = from[2];
+                                pixel->pad   = 0;
+                                from += 3;
+                                continue;
+                        }
+                        Pnm_rgb pixel = row_cells_next(&cells);
+                        if (stream->pixel_size == 3) {
+                                pixel->red   = from[0];
+                                pixel->green = from[1];
+                                pixel->blue  = from[2];
+                        } else {
+                                pixel->red   = from[0] << 8 | from[1];
+                                pixel->green = from[2] << 8 | from[3];
+                                pixel->blue  = from[4] << 8 | from[5];
+                        }
+                        from += stream->pixel_size;
+                }
+        }
+        free(raw);
+}
+
+/********** Ppmstream_write_pixels ********
+ *
+ * Parameters:
+ *      FILE *out: where the image goes
+ *      A2Methods_T methods: the suite that made pixels
+ *      A2Methods_UArray2 pixels: struct Pnm_rgb cells, or struct
+ *                                Ppmstream_rgb8 ones
+ *      unsigned denominator: the image's denominator, at most
+ *                            PPMSTREAM_PACKED_MAX for packed cells
+ ************************/
+void Ppmstream_write_pixels(FILE *out, A2Methods_T methods,
+                            A2Methods_UArray2 pixels, unsigned denominator)
+{
+        assert(out != NULL && methods != NULL && pixels != NULL);
+        assert(denominator > 0 && denominator <= 65535);
+        bool packed = is_packed(methods->size(pixels));
+        assert(!packed || denominator <= PPMSTREAM_PACKED_MAX);
+
+        unsigned width = methods->width(pixels);
+        unsigned height = methods->height(pixels);
+        int pixel_size = denominator > 255 ? 6 : 3;
+        unsigned char *raw = malloc((size_t)width * pixel_size);
+        assert(raw != NULL);
+        struct row_cells cells;
+        row_cells_init(&cells, methods, pixels);
+
+        Ppmstream_write_header(out, width, height, denominator);
+        for (unsigned row = 0; row < height; row++) {
+                row_cells_seek(&cells, row);
+
+                unsigned char *to = raw;
+                for (unsigned col = 0; col < width; col++) {
+                        if (packed) {
+                                Ppmstream_rgb8 pixel = row_cells_next(&cells);
+                                to[0] = pixel->red;
+                                to[1] = pixel->green;
+                                to[2] = pixel->blue;
+                                to += 3;
+                                continue;
+                        }
+                        Pnm_rgb pixel = row_cells_next(&cells);
+                        if (pixel_size == 3) {
+                                to[0] = pixel->red;
+                                to[1] = pixel->green;
+                                to[2] = pixel->blue;
+                        } else {
+                                to[0] = pixel->red >> 8;
+                                to[1] = pixel->red;
+                                to[2] = pixel->green >> 8;
+                                to[3] = pixel->green;
+                                to[4] = pixel->blue >> 8;
+                                to[5] = pixel->blue;
+                        }
+                        to += pixel_size;
+                }
+                Ppmstream_write(out, raw, (size_t)width * pixel_size);
+        }
+        free(raw);
+}
+
+/********** Ppmstream_copy_pixels ********
+ *
+ * Parameters:
+ *      A2Methods_T from_methods: the suite that made from
+ *      A2Methods_UArray2 from: struct Pnm_rgb cells, as Pnm_ppmread 
+ *                              makes them
+ *      A2Methods_T to_methods: the suite that made to
+ *      A2Methods_UArray2 to: an array of the same dimensions, of struct
+ *                            Pnm_rgb or struct Ppmstream_rgb8 cells
+ *
+ * Notes:
+ *      How an image ppmstream cannot read gets into a packed array.  A
+ *      value that does not fit a packed cell is a checked run-time 
+ *      error
+ ************************/
+void Ppmstream_copy_pixels(A2Methods_T from_methods, 
+                           A2Methods_UArray2 from, A2Methods_T to_methods,
+                           A2Methods_UArray2 to)
+{
+        assert(from_methods != NULL && from != NULL);
+        assert(to_methods != NULL && to != NULL);
+        assert(from_methods->size(from) == sizeof(struct Pnm_rgb));
+        int width = from_methods->width(from);
+        int height = from_methods->height(from);
+        assert(to_methods->width(to) == width);
+        assert(to_methods->height(to) == height);
+        bool packed = is_packed(to_methods->size(to));
+
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        Pnm_rgb pixel = from_methods->at(from, col, row);
+                        if (!packed) {
+                                *(Pnm_rgb)to_methods->at(to, col, row) =
+                                        *pixel;
+                                continue;
+                        }
+                        assert(pixel->red <= PPMSTREAM_PACKED_MAX
+                               && pixel->green <= PPMSTREAM_PACKED_MAX
+                               && pixel->blue <= PPMSTREAM_PACKED_MAX);
+                        Ppmstream_rgb8 cell = to_methods->at(to, col, row);
+                        cell->red = pixel->red;
+                        cell->green = pixel->green;
+                        cell->blue = pixel->blue;
+                        cell->pad = 0;
+                }
+        }
+}
+
+/********** Ppmstream_reverse ********
+ *
+ * Parameters:
+ *      void *dst: where the reversed pixels go
+ *      const void *src: count pixels of raw raster
+ *      unsigned count: number of pixels
+ *      int pixel_size: 3 or 6
+ *
+ * Notes:
+ *      The two common pixel sizes get their own loop so each copy is a
+ *      fixed-size memcpy, which compiles to a couple of moves
+ ************************/
+void Ppmstream_reverse(void *dst, const void *src, unsigned count,
+                       int pixel_size)
+{
+        char *to = (char *)dst + (size_t)count * pixel_size;
+        const char *from = src;
+
+        if (pixel_size == 3) {
+                for (unsigned i = 0; i < count; i++) {
+                        to -= 3;
+                        memcpy(to, from, 3);
+                        from += 3;
+                }
+        } else if (pixel_size == 6) {
+                for (unsigned i = 0; i < count; i++) {
+                        to -= 6;
+                        memcpy(to, from, 6);
+                        from += 6;
+                }
+        } else {
+                for (unsigned i = 0; i < count; i++) {
+                        to -= pixel_size;
+                        memcpy(to, from, pixel_size);
+                        from += pixel_size;
+                }
+        }
+}
+
+/*****************************************************************
+ *                        Streamed transforms
+ *****************************************************************/
+
+bool Ppmstream_can_transform(A2Transform_T kind)
+{
+        return kind >= A2_ROTATE_0 && kind <= A2_TRANSVERSE;
+}
+
+/* true for the transforms that turn rows into columns */
+static inline bool swaps_axes(A2Transform_T kind)
+{
+        return kind == A2_ROTATE_90 || kind == A2_ROTATE_270
+               || kind == A2_TRANSPOSE || kind == A2_TRANSVERSE;
+}
+
+/* memcpy with a constant size becomes plain moves for the usual pixels */
+static inline void copy_pixel(char *dst, const char *src, int pixel_size)
+{
+        if (pixel_size == 3) {
+                memcpy(dst, src, 3);
+        } else if (pixel_size == 6) {
+                memcpy(dst, src, 6);
+        } else {
+                memcpy(dst, src, pixel_size);
+        }
+}
+
+/* reads size bytes at offset of fd, however many calls it takes */
+static void read_at(int fd, void *buf, size_t size, off_t offset)
+{
+        char *to = buf;
+        while (size > 0) {
+                ssize_t got = pread(fd, to, size, offset);
+                assert(got > 0);
+                to += got;
+                size -= got;
+                offset += got;
+        }
+}
+
+/********** raster_offset ********
+ *
+ * Finds where the rest of the stream's raster can be read with pread
+ *
+ * Parameters:
+ *      T stream: a stream no rows of which have been read yet
+ *      int *fd: set to the descriptor to read from
+ *      FILE **spill: set to the temporary file holding the raster, or
+ *                    NULL if it is read straight from the input
+ *      char *band, size_t band_size: buffer used to copy the raster
+ *
+ * Return:
+ *      the offset of row 0 within *fd
+ *
+ * Notes:
+ *      A regular file can be read in any order, starting from where the
+ *      header ended.  Anything else (a pipe, a terminal), or a file too
+ *      short to hold the raster, is copied into an unnamed temporary
+ *      file a band at a time first, so the raster ending early is found
+ *      the way a row-by-row read finds it.
+ ************************/
+static off_t raster_offset(T stream, int *fd, FILE **spill, char *band,
+                           size_t band_size)
+{
+        off_t raster_size = (off_t)stream->stride * stream->height;
+        off_t offset = ftello(stream->fp);
+        struct stat info;
+
+        *fd = fileno(stream->fp);
+        *spill = NULL;
+        if (offset >= 0 && fstat(*fd, &info) == 0 && S_ISREG(info.st_mode)
+            && info.st_size - offset >= raster_size) {
+                return offset;
+        }
+
+        *spill = tmpfile();
+        assert(*spill != NULL);
+        for (off_t left = raster_size; left > 0; ) {
+                size_t n = left < (off_t)band_size ? (size_t)left
+                                                   : band_size;
+                read_raster(stream, band, n);
+                Ppmstream_write(*spill, band, n);
+                left -= n;
+        }
+        int flushed = fflush(*spill);
+        assert(flushed == 0);
+        (void)flushed;
+        *fd = fileno(*spill);
+        return 0;
+}
+
+/********** reverse_rows ********
+ *
+ * Writes the stream's rows bottom row first, reversing each row too when
+ * kind is A2_ROTATE_180
+ *
+ * Notes:
+ *      The rows are read a band at a time, starting with the band at the
+ *      bottom, with one pread per band.  The band plus one output row
+ *      fit in 'memory'.
+ ************************/
+static void reverse_rows(A2Transform_T kind, T stream, FILE *out,
+                         size_t memory)
+{
+        size_t row_size = stream->row_size;
+        size_t stride = stream->stride;
+        size_t band_rows = memory / stride;
+        band_rows = band_rows > 2 ? band_rows - 1 : 1;
+        if (band_rows > stream->height) {
+                band_rows = stream->height;
+        }
+
+        char *band = malloc(band_rows * stride);
+        char *out_row = malloc(row_size);
+        assert(band != NULL && out_row != NULL);
+
+        int fd;
+        FILE *spill;
+        off_t raster = raster_offset(stream, &fd, &spill, band,
+                                     band_rows * stride);
+
+        unsigned row1 = stream->height;
+        while (row1 > 0) {
+                unsigned row0 = row1 > band_rows ? row1 - band_rows : 0;
+                read_at(fd, band, (size_t)(row1 - row0) * stride,
+                        raster + (off_t)row0 * stride);
+
+                for (unsigned row = row1; row-- > row0; ) {
+                        char *in_row = band + (size_t)(row - row0) * stride
+                                       + stream->skip;
+                        if (kind == A2_ROTATE_180) {
+                                Ppmstream_reverse(out_row, in_row, 
+                                                  stream->width,
+                                                  stream->pixel_size);
+                                Ppmstream_write(out, out_row, row_size);
+                        } else {
+                                Ppmstream_write(out, in_row, row_size);
+                        }
+                }
+                row1 = row0;
+        }
+
+        /* the rows have all been consumed, one way or another */
+        stream->rows_read = stream->height;
+        if (spill != NULL) {
+                fclose(spill);
+        }
+        free(band);
+        free(out_row);
+}
+
+/*****************************************************************
+ *                 Out-of-core quarter turns
+ *****************************************************************/
+
+/* writes size bytes at offset of fd, however many calls it takes */
+static void write_at(int fd, const void *buf, size_t size, off_t offset)
+{
+        const char *from = buf;
+        while (size > 0) {
+                ssize_t put = pwrite(fd, from, size, offset);
+                assert(put > 0);
+                from += put;
+                size -= put;
+                offset += put;
+        }
+}
+
+/*
+ * an unnamed scratch file in $TMPDIR (or /tmp), so a large job can be
+ * pointed at a disk rather than a RAM-backed /tmp
+ */
+static int scratch_file(void)
+{
+        const char *dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0') {
+                dir = "/tmp";
+        }
+
+        size_t length = strlen(dir) + sizeof("/ppmtrans-XXXXXX");
+        char *path = malloc(length);
+        assert(path != NULL);
+        snprintf(path, length, "%s/ppmtrans-XXXXXX", dir);
+
+        int fd = mkstemp(path);
+        assert(fd >= 0);
+        unlink(path);           /* its space is freed when fd is closed */
+        free(path);
+        return fd;
+}
+
+/********** cut_tile ********
+ *
+ * Copies columns c0 ... c0 + cols - 1 of a band of b rows into tile,
+ * already turned: one run of b pixels per source column, in the order
+ * those pixels take in their destination row
+ *
+ * Notes:
+ *      Goes 32 x 32 pixels at a time so the reads across band rows and
+ *      the writes across tile runs both stay in cache
+ ************************/
+static void cut_tile(bool rows_up, const char *band, size_t row_size,
+                     unsigned b, unsigned c0, unsigned cols, int pixel_size,
+                     char *tile)
+{
+        enum { STEP = 32 };
+
+        for (unsigned i0 = 0; i0 < b; i0 += STEP) {
+                unsigned i1 = i0 + STEP < b ? i0 + STEP : b;
+                for (unsigned j0 = 0; j0 < cols; j0 += STEP) {
+                        unsigned j1 = j0 + STEP < cols ? j0 + STEP : cols;
+                        for (unsigned i = i0; i < i1; i++) {
+                                const char *from = band + i * row_size
+                                                   + (size_t)(c0 + j0)
+                                                     * pixel_size;
+                                size_t k = rows_up ? b - 1 - i : i;
+                                for (unsigned j = j0; j < j1; j++) {
+                                        copy_pixel(tile + ((size_t)j * b + k)
+                                                          * pixel_size,
+                                                   from, pixel_size);
+                                        from += pixel_size;
+                                }
+                        }
+                }
+        }
+}
+
+/********** swap_axes ********
+ *
+ * Applies a quarter turn, transpose or transverse without ever holding
+ * more than 'memory' bytes of pixels
+ *
+ * Notes:
+ *      Every output row is one input column, so it needs a pixel from
+ *      every input row.  The input is read once, top to bottom, in bands
+ *      of rows; each band is cut into tiles of tile_cols columns, turned,
+ *      and written to a scratch file.  The scratch file keeps all tiles
+ *      of a column group together, so once the input is done each group
+ *      is one pread, and its output rows are put together from one run
+ *      per band and written out in order.
+ *
+ *      A full group (tile_cols output rows) plus the row being built
+ *      fits in memory, and so does a band plus one tile.
+ ************************/
+static void swap_axes(A2Transform_T kind, T stream, FILE *out, size_t memory)
+{
+        unsigned w = stream->width;
+        unsigned h = stream->height;
+        int ps = stream->pixel_size;
+        size_t row_size = stream->row_size;
+        size_t out_row_size = (size_t)h * ps;
+
+        /* the destination starts from the bottom of the source when its
+         * column counts down from the source row (90, transverse), and
+         * from the right of the source when its row counts down from
+         * the source column (270, transverse) */
+        bool rows_up = kind == A2_ROTATE_90 || kind == A2_TRANSVERSE;
+        bool cols_up = kind == A2_ROTATE_270 || kind == A2_TRANSVERSE;
+
+        size_t tile_cols = memory / out_row_size;
+        tile_cols = tile_cols > 1 ? tile_cols - 1 : 1;
+        if (tile_cols > w) {
+                tile_cols = w;
+        }
+        size_t band_rows = memory / ((w + tile_cols) * ps);
+        band_rows = band_rows > 1 ? band_rows : 1;
+        if (band_rows > h) {
+                band_rows = h;
+        }
+
+        int fd = scratch_file();
+
+        /* pass 1: source bands, cut into turned tiles */
+        char *band = malloc(band_rows * row_size);
+        char *tile = malloc(tile_cols * band_rows * ps);
+        assert(band != NULL && tile != NULL);
+
+        for (unsigned r0 = 0; r0 < h; r0 += band_rows) {
+                unsigned b = h - r0 < band_rows ? h - r0 : band_rows;
+                for (unsigned i = 0; i < b; i++) {
+                        Ppmstream_read_row(stream, band + i * row_size);
+                }
+                for (unsigned c0 = 0; c0 < w; c0 += tile_cols) {
+                        unsigned cols = w - c0 < tile_cols ? w - c0
+                                                           : tile_cols;
+                        cut_tile(rows_up, band, row_size, b, c0, cols, ps,
+                                 tile);
+                        write_at(fd, tile, (size_t)cols * b * ps,
+                                 (off_t)c0 * out_row_size
+                                 + (off_t)r0 * cols * ps);
+                }
+        }
+        free(band);
+        free(tile);
+
+        /* pass 2: destination rows, in order, one column group at a time */
+        char *group = malloc(tile_cols * out_row_size);
+        char *out_row = malloc(out_row_size);
+        assert(group != NULL && out_row != NULL);
+
+        unsigned loaded = w;    /* first column of the group in memory */
+        unsigned cols = 0;
+        for (unsigned new_row = 0; new_row < w; new_row++) {
+                unsigned col = cols_up ? w - 1 - new_row : new_row;
+                if (loaded == w || col < loaded || col >= loaded + cols) {
+                        loaded = col / tile_cols * tile_cols;
+                        cols = w - loaded < tile_cols ? w - loaded
+                                                      : tile_cols;
+                        read_at(fd, group, cols * out_row_size,
+                                (off_t)loaded * out_row_size);
+                }
+
+                for (unsigned r0 = 0; r0 < h; r0 += band_rows) {
+                        unsigned b = h - r0 < band_rows ? h - r0 : band_rows;
+                        unsigned new_col = rows_up ? h - r0 - b : r0;
+                        memcpy(out_row + (size_t)new_col * ps,
+                               group + ((size_t)r0 * cols
+                                        + (size_t)(col - loaded) * b) * ps,
+                               (size_t)b * ps);
+                }
+                Ppmstream_write(out, out_row, out_row_size);
+        }
+
+        free(group);
+        free(out_row);
+        close(fd);
+}
+
+/* rotates by 0 or flips horizontally, one row in and one row out */
+static void keep_rows(A2Transform_T kind, T stream, FILE *out)
+{
+        size_t row_size = stream->row_size;
+        char *in_row = malloc(row_size);
+        char *out_row = malloc(row_size);
+        assert(in_row != NULL && out_row != NULL);
+
+        for (unsigned row = 0; row < stream->height; row++) {
+                Ppmstream_read_row(stream, in_row);
+                if (kind == A2_FLIP_HORIZONTAL) {
+                        Ppmstream_reverse(out_row, in_row, stream->width,
+                                          stream->pixel_size);
+                        Ppmstream_write(out, out_row, row_size);
+                } else {
+                        Ppmstream_write(out, in_row, row_size);
+                }
+        }
+
+        free(in_row);
+        free(out_row);
+}
+
+/********** Ppmstream_transform ********
+ *
+ * Parameters:
+ *      A2Transform_T kind: the transform
+ *      T stream: the input, no rows of which have been read yet
+ *      FILE *out: where the transformed image is written
+ *      size_t memory: most bytes of rows to hold at once
+ *
+ * Return:
+ *      None
+ *
+ * Expects:
+ *      Ppmstream_can_transform(kind) (checked runtime error)
+ *
+ * Notes:
+ *      A transform that keeps the row order writes each output row
+ *      before the next input row is read, so output starts right away
+ *      and memory use is two rows no matter how tall the image is.
+ *      The others keep to 'memory' with the help of the file system.
+ ************************/
+void Ppmstream_transform(A2Transform_T kind, T stream, FILE *out,
+                         size_t memory)
+{
+        assert(stream != NULL && out != NULL);
+        assert(Ppmstream_can_transform(kind));
+        assert(stream->rows_read == 0);
+
+        int new_width, new_height;
+        A2Transform_dims(kind, stream->width, stream->height, &new_width,
+                         &new_height);
+        Ppmstream_write_header(out, new_width, new_height,
+                               stream->denominator);
+        if (swaps_axes(kind)) {
+                swap_axes(kind, stream, out, memory);
+        } else if (kind == A2_FLIP_VERTICAL || kind == A2_ROTATE_180) {
+                reverse_rows(kind, stream, out, memory);
+        } else {
+                keep_rows(kind, stream, out);
+        }
+}
@@ -0,0 +1,176 @@
+/**************************************************************
+ *
+ *                     ppmstream.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Row-at-a-time access to a binary (P6) PPM, for transforms that do
+ *     not need the whole image in memory.  Rows are kept in their raw
+ *     raster form, 3 bytes a pixel (6 when the denominator is over
+ *     255), so they can be written back out without being decoded.
+ *     Whole images are read into, and written from, arrays of struct
+ *     Pnm_rgb, or of the packed struct Ppmstream_rgb8 when the
+ *     denominator allows it.
+ *
+ **************************************************************/
+
+#ifndef PPMSTREAM_INCLUDED
+#define PPMSTREAM_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+#include "a2transform.h"
+
+#define T Ppmstream_T
+typedef struct T *T;
+
+/*
+ * a pixel of an image whose denominator is at most
+ * PPMSTREAM_PACKED_MAX, in 4 bytes instead of a Pnm_rgb's 12.  The pad
+ * byte keeps every cell aligned, so moving one is a single 32-bit move;
+ * it is always 0
+ */
+typedef struct Ppmstream_rgb8 {
+        unsigned char red, green, blue, pad;
+} *Ppmstream_rgb8;
+
+#define PPMSTREAM_PACKED_MAX 255
+
+/*
+ * reads the P6 header from fp, leaving fp at the first raster byte.
+ * Input that is not a P6 header is a checked run-time error
+ */
+extern T Ppmstream_open(FILE *fp);
+
+/*
+ * Ppmstream_open for input that may be bad: NULL, with fp partly read,
+ * if fp does not start with a valid P6 header.  A raster that ends
+ * early is not an error for the stream this returns: the missing bytes
+ * read as zero and Ppmstream_truncated becomes true
+ */
+extern T Ppmstream_try_open(FILE *fp);
+
+/* true if a stream from Ppmstream_try_open has run out of raster */
+extern bool Ppmstream_truncated(T stream);
+
+/*
+ * reads the magic number from fp, nothing of which has been read, and 
+ * returns its second character ('6' for a P6); EOF if fp ends after 
+ * the P, and 0, with nothing consumed, if fp does not start with a P
+ */
+extern int Ppmstream_read_magic(FILE *fp);
+
+/* Ppmstream_open and Ppmstream_try_open once Ppmstream_read_magic has 
+ * read a P6 magic number from fp */
+extern T Ppmstream_open_after_magic(FILE *fp);
+extern T Ppmstream_try_open_after_magic(FILE *fp);
+
+/*
+ * puts back the magic number Ppmstream_read_magic read from fp, so that
+ * Pnm_ppmread can read the other formats it knows.  Returns fp, or if 
+ * fp cannot seek, a temporary copy of its contents that the caller 
+ * closes as well as fp
+ */
+extern FILE *Ppmstream_unread_magic(FILE *fp, int magic);
+
+/* frees *stream and sets it to NULL; does not close its file */
+extern void Ppmstream_free(T *stream);
+
+/* the dimensions of the image, or of the crop once there is one */
+extern unsigned Ppmstream_width(T stream);
+extern unsigned Ppmstream_height(T stream);
+extern unsigned Ppmstream_denominator(T stream);
+/* bytes per pixel in the raster: 3, or 6 when the denominator is > 255 */
+extern int Ppmstream_pixel_size(T stream);
+/* bytes per raster row */
+extern size_t Ppmstream_row_size(T stream);
+
+/*
+ * narrows the stream to the width x height pixels whose top left is
+ * (x, y): from then on it reads as if it were that image, and nothing
+ * outside the crop is decoded.  Must come before any row is read, and
+ * the crop must lie inside the image (checked run-time errors)
+ */
+extern void Ppmstream_crop(T stream, unsigned x, unsigned y, unsigned width,
+                           unsigned height);
+
+/*
+ * reads the next row's raw bytes into row, which holds at least
+ * Ppmstream_row_size bytes.  Reading past the last row is a checked
+ * run-time error, and so is running into the end of the file unless
+ * the stream came from Ppmstream_try_open
+ */
+extern void Ppmstream_read_row(T stream, void *row);
+
+/*
+ * reads the rest of the raster into pixels, an array made by methods
+ * with the stream's dimensions and cells of struct Pnm_rgb, or of
+ * struct Ppmstream_rgb8 if the denominator is at most
+ * PPMSTREAM_PACKED_MAX (checked run-time errors).  Unlike Pnm_ppmread
+ * this lets the caller reuse an array, and keeps no state outside the
+ * stream, so threads can read different files at once
+ */
+extern void Ppmstream_read_pixels(T stream, A2Methods_T methods,
+                                  A2Methods_UArray2 pixels);
+
+/*
+ * writes pixels, an array of struct Pnm_rgb or struct Ppmstream_rgb8,
+ * to out as a P6 image.  A packed array needs a denominator of at most
+ * PPMSTREAM_PACKED_MAX (checked run-time error)
+ */
+extern void Ppmstream_write_pixels(FILE *out, A2Methods_T methods,
+                                   A2Methods_UArray2 pixels,
+                                   unsigned denominator);
+
+/*
+ * copies from, an array of struct Pnm_rgb, into to, an array of the
+ * same dimensions and struct Pnm_rgb or struct Ppmstream_rgb8 cells,
+ * which may come from another suite
+ */
+extern void Ppmstream_copy_pixels(A2Methods_T from_methods,
+                                  A2Methods_UArray2 from,
+                                  A2Methods_T to_methods,
+                                  A2Methods_UArray2 to);
+
+/* writes the header of a P6 image; the raster must follow */
+extern void Ppmstream_write_header(FILE *out, unsigned width, unsigned height,
+                                   unsigned denominator);
+
+/* writes size raw raster bytes (checked run-time error if it fails) */
+extern void Ppmstream_write(FILE *out, const void *bytes, size_t size);
+
+/*
+ * copies count pixels of pixel_size bytes from src to dst in reverse
+ * order; src and dst must not overlap
+ */
+extern void Ppmstream_reverse(void *dst, const void *src, unsigned count,
+                              int pixel_size);
+
+/* memory budget used when the caller does not give one */
+#define PPMSTREAM_DEFAULT_MEMORY ((size_t)64 << 20)
+
+/* true if Ppmstream_transform can apply kind to a stream (all eight) */
+extern bool Ppmstream_can_transform(A2Transform_T kind);
+
+/*
+ * reads the rest of stream, applies kind, and writes the result to out
+ * as a P6 image.  Row-local transforms hold one input and one output
+ * row; the ones that reverse the row order hold at most 'memory' bytes
+ * of rows (but never less than two rows), reading the input backwards
+ * when it is a regular file and spilling it to a temporary file when
+ * it is not.  Quarter turns and diagonal mirrors write turned tiles to
+ * a scratch file in $TMPDIR and put the output rows together from it,
+ * holding at most 'memory' bytes of pixels (but never less than two
+ * output rows).  Expects Ppmstream_can_transform(kind) (checked
+ * run-time error)
+ */
+extern void Ppmstream_transform(A2Transform_T kind, T stream, FILE *out,
+                                size_t memory);
+
+#undef T
+#endif
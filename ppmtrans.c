@@ -10,23 +10,62 @@
  *     This program applies transformations to a PPM image.
  *     Program uses pnm.h to read the image and turn it into an array (uarray2b
  *     or uarray2b) depending on if the traversal specified.
- *     It supports rotations (0, 90, 180, 270 degrees) and 
- *     flips (horizontally and vertically). The program also 
+ *     It supports rotations (0, 90, 180, 270 degrees), 
+ *     flips (horizontally and vertically), transposes and 
+ *     transverses (mirroring across either diagonal), given in 
+ *     any number and order; the whole chain is reduced to one 
+ *     transform and applied in a single pass. -angle and -affine 
+ *     go beyond those eight: the chain then becomes one matrix and 
+ *     the image is resampled through it (nearest or bilinear), 
+ *     which is how a scan is deskewed. -scale 1/N averages each 
+ *     N x N block of pixels into one in the same pass, and -crop 
+ *     decodes and transforms only part of the input. The program also 
  *     allows different traversals of the images for processing 
  *     (row-major, column-major, and block-major). 
+ *     With -stream, the image is never read into an array: 
+ *     transforms that keep every row whole are done a row at a 
+ *     time, and quarter turns go through a scratch file, all in at 
+ *     most -memory bytes, so images larger than RAM can be handled. 
  *     It measures the execution time per pixel if a 
- *     timing file is specified.
+ *     timing file is specified, and with -phases appends a JSON line 
+ *     giving the wall-clock and CPU time of every phase of the run;
+ *     -counters adds hardware event counts there and to -benchmark.
+ *     -cachesim writes no image either: it runs the transform through 
+ *     a model of the -cache levels and reports their hit and miss 
+ *     rates for the source and destination arrays.  -trace records 
+ *     every pixel the transform touches in a binary file that 
+ *     tracestat summarises.  -plan works out where every pixel goes 
+ *     before the transform starts, so the transform itself is table 
+ *     lookups; a batch of same-sized images shares one plan.  It only 
+ *     applies to blocked arrays, and not to the transforms that have 
+ *     a vectorised path there.
+ *     Images with a denominator of at most 255 are held 4 bytes a 
+ *     pixel instead of 12 (-unpacked turns this off), which cuts the 
+ *     memory every transform and traversal moves by two thirds.
  *     Program outputs newly transformed image in binary to STDOUT.
+ *     With -outdir, it instead transforms any number of files (named 
+ *     on the command line, or one per line on stdin) into that 
+ *     directory, -jobs at a time. -benchmark writes no image: it 
+ *     times every transform, traversal and block size on the input 
+ *     and prints a CSV or JSON table of nanoseconds per pixel. 
+ *     -blocksize picks the block size of block-major arrays, and 
+ *     -blocksize-sweep times one transform over a range of them.
+ *     Batch mode, -benchmark, -cachesim and -phases timing are in 
+ *     batch.c, benchmark.c, cachedriver.c and phases.c, which share 
+ *     the options and the transform pipeline through ppmtrans.h.
  *
  *     
  *
  **************************************************************/
 
- #include <stdio.h>
  #include <stdio.h>
  #include <string.h>
  #include <stdlib.h>
  #include <stdbool.h>
+ #include <stdint.h>
+ #include <math.h>
+ #include <unistd.h>
+ #include <pthread.h>
  
  #include "assert.h"
  #include "a2methods.h"
@@ -34,8 +73,20 @@
  #include "a2blocked.h"
  #include "pnm.h"
  #include "cputiming.h"
- 
- typedef A2Methods_UArray2 A2;
+ #include "perfcount.h"
+ #include "cachesim.h"
+ #include "a2watch.h"
+ #include "a2trace.h"
+ #include "a2transform.h"
+ #include "a2affine.h"
+ #include "a2plan.h"
+ #include "uarray2b.h"
+ #include "ppmstream.h"
+ #include "ppmtrans.h"
+ #include "phases.h"
+ #include "batch.h"
+ #include "benchmark.h"
+ #include "cachedriver.h"
  
  #define SET_METHODS(METHODS, MAP, WHAT) do {                    \
          methods = (METHODS);                                    \
@@ -53,17 +104,38 @@
  usage(const char *progname)
  {
          fprintf(stderr, "Usage: %s [-rotate <angle>] "
-                         "[-{row,col,block}-major] "
-                         "[-time time_file] "
+                         "[-flip {horizontal,vertical}] "
+                         "[-transpose] [-transverse] "
+                         "[-angle degrees] [-affine a,b,c,d] "
+                         "[-interp {nearest,bilinear}] [-scale 1/N] "
+                         "[-crop x,y,w,h] "
+                         "[-{row,col,block}-major] [-blocksize N] "
+                         "[-time time_file] [-phases phases_file] "
+                         "[-counters] [-trace trace_file] [-plan] "
+                         "[-unpacked] [-in-place] [-threads N] "
+                         "[-stream] [-memory bytes[KMG]] "
+                         "[filename]\n"
+                         "       %s [options] -outdir dir [-jobs N] "
+                         "[filename...]\n"
+                         "       %s -benchmark [-blocksize N] [-runs N] "
+                         "[-warmups N] [-format {csv,json}] [-counters] "
+                         "[-plan] [-unpacked] [filename]\n"
+                         "       %s -blocksize-sweep lo:hi[:step] "
+                         "[transform] [-runs N] [-warmups N] "
+                         "[-format {csv,json}] [-counters] [filename]\n"
+                         "       %s -cachesim [-cache size/ways/line]... "
+                         "[transform] [-{row,col,block}-major] "
+                         "[-blocksize N] [-format {csv,json}] "
                          "[filename]\n",
-                         progname);
+                         progname, progname, progname, progname, progname);
          exit(1);
  }
  
  /* struct so we can pass the arrays and methods into the apply function */
  struct Closure { 
-         A2Methods_T new_array;
+         A2 new_array;
          A2Methods_T methods;
+         int size;               /* bytes in a pixel of either array */
  };
  
  /*****************************************************************
@@ -97,7 +169,7 @@
          assert(array != NULL);
  
          struct Closure *closure = cl;
-         A2Methods_T new_array = closure->new_array;
+         A2 new_array = closure->new_array;
          A2Methods_T methods = closure->methods;
  
          /* find new row and column for pixel */
@@ -107,11 +179,11 @@
          assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
          new_row < 0 || new_row >= methods->height(new_array)));
  
-         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
-         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
          /*set pixel in new spot*/
-         *dest = *src; 
+         memcpy(dest, src, closure->size); 
  }
  
  /********** vertical_flip ********
@@ -141,7 +213,7 @@
          assert(array != NULL);
  
          struct Closure *closure = cl;
-         A2Methods_T new_array = closure->new_array;
+         A2 new_array = closure->new_array;
          A2Methods_T methods = closure->methods;
  
          /* find new row and column for pixel */
@@ -151,33 +223,91 @@
          assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
          new_row < 0 || new_row >= methods->height(new_array)));
  
-         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
-         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
          /*set pixel in new spot*/
-         *dest = *src; 
+         memcpy(dest, src, closure->size); 
  }
  
- // static void transpose(int col, int row, A2 array, A2Methods_Object *ptr, 
- //                       void *cl)
- // {
- //         struct Closure *closure = cl;
- //         A2Methods_T new_array = closure->new_array;
- //         A2Methods_T methods = closure->methods;
+ /********** transpose ********
+  *
+  * Translates a pixel from the original matrix to its mirror image across
+  * the main diagonal, so columns of the original become rows of the new 
+  * image.
+  *
+  * Parameters:
+  * int col: the column coordinate of the pixel in the A2 array
+  * int row: the row coordinate of the pixel in the A2 array
+  * A2Methods_Object *ptr: a pointer to the source pixel in the new image
+  * void *cl: a pointer to the closure struct, containing the translated
+  * image and the A2 methods
+  *
+  * Return: 
+  * None
+  *
+  * Notes:
+  * Will check runtime error if the calculated new dimensions are out
+  * of bounds.
+  ************************/
+ static void transpose(int col, int row, A2 array, A2Methods_Object *ptr, 
+                       void *cl)
+ {
+         struct Closure *closure = cl;
+         A2 new_array = closure->new_array;
+         A2Methods_T methods = closure->methods;
  
- //         int new_row = col;
- //         int new_col = methods->width(array) - col - 1;
+         (void) array;
+
+         int new_row = col;
+         int new_col = row;
+         
+         assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
+         new_row < 0 || new_row >= methods->height(new_array)));
+ 
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
+ 
+         memcpy(dest, src, closure->size);        
+ }
+ 
+ /********** transverse ********
+  *
+  * Translates a pixel from the original matrix to its mirror image across
+  * the anti-diagonal (top-right to bottom-left corner).
+  *
+  * Parameters:
+  * int col: the column coordinate of the pixel in the A2 array
+  * int row: the row coordinate of the pixel in the A2 array
+  * A2Methods_Object *ptr: a pointer to the source pixel in the new image
+  * void *cl: a pointer to the closure struct, containing the translated
+  * image and the A2 methods
+  *
+  * Return: 
+  * None
+  *
+  * Notes:
+  * Will check runtime error if the calculated new dimensions are out
+  * of bounds.
+  ************************/
+ static void transverse(int col, int row, A2 array, A2Methods_Object *ptr, 
+                        void *cl)
+ {
+         struct Closure *closure = cl;
+         A2 new_array = closure->new_array;
+         A2Methods_T methods = closure->methods;
  
- //         // printf("new col: %d, width of new array %d, new row %d, height of new array %d\n", new_col, methods->width(new_array), new_row, methods->height(new_array));
+         int new_row = methods->width(array) - col - 1;
+         int new_col = methods->height(array) - row - 1;
          
- //         assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
- //         new_row < 0 || new_row >= methods->height(new_array)));
+         assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
+         new_row < 0 || new_row >= methods->height(new_array)));
  
- //         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
- //         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
- //         *dest = *src;        
- // }
+         memcpy(dest, src, closure->size);        
+ }
  
  /********** rotate_90 ********
   *
@@ -205,7 +335,7 @@
  {
          /* grabbing arrays from closure */
          struct Closure *closure = cl;
-         A2Methods_T new_array = closure->new_array;
+         A2 new_array = closure->new_array;
          A2Methods_T methods = closure->methods;
  
          int new_row = col;
@@ -214,10 +344,10 @@
          assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
          new_row < 0 || new_row >= methods->height(new_array)));
  
-         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
-         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
-         *dest = *src;
+         memcpy(dest, src, closure->size);
  
  }
  
@@ -247,7 +377,7 @@
  {
          /* grabbing arrays from closure */
          struct Closure *closure = cl;
-         A2Methods_T new_array = closure->new_array;
+         A2 new_array = closure->new_array;
          A2Methods_T methods = closure->methods;
  
          int new_row = methods->height(array) - row - 1;
@@ -258,10 +388,10 @@
                  ||new_row < 0 
                  || new_row >= methods->height(new_array)));
  
-         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
-         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
-         *dest = *src;
+         memcpy(dest, src, closure->size);
  }
  
  /********** rotate_270 ********
@@ -290,7 +420,7 @@
  {
          /* grabbing arrays from closure */
          struct Closure *closure = cl;
-         A2Methods_T new_array = closure->new_array;
+         A2 new_array = closure->new_array;
          A2Methods_T methods = closure->methods;
  
          int new_row = methods->width(array) - col - 1;
@@ -299,17 +429,17 @@
          assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
          new_row < 0 || new_row >= methods->height(new_array)));
  
-         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
-         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
-         *dest = *src;     
+         memcpy(dest, src, closure->size);     
  }
 
  static void rotate_0(int col, int row, A2Methods_UArray2 array, A2Methods_Object *ptr, void *cl)
  {
          /* grabbing arrays from closure */
          struct Closure *closure = cl;
-         A2Methods_T new_array = closure->new_array;
+         A2 new_array = closure->new_array;
          A2Methods_T methods = closure->methods;
  
          (void) array;
@@ -320,10 +450,10 @@
          assert(!(new_col < 0 || new_col >= methods->width(new_array) ||
          new_row < 0 || new_row >= methods->height(new_array)));
  
-         Pnm_rgb dest = methods->at(new_array, new_col, new_row);
-         Pnm_rgb src = ptr;
+         A2Methods_Object *dest = methods->at(new_array, new_col, new_row);
+         A2Methods_Object *src = ptr;
  
-         *dest = *src;     
+         memcpy(dest, src, closure->size);     
  }
  
  static void mem_cleanup(Pnm_ppm image, Pnm_ppm new_image, FILE *fp,
@@ -336,54 +466,607 @@
          fclose(fp);
  }
  
- static void rotation_flip(char *flip_type, A2Methods_mapfun *map, int rotation, int width, int height, 
-         Pnm_ppm image, Pnm_ppm new_image, struct Closure cl)
+ /* per-pixel callback for each transform, used when the methods suite
+  * has no native version of it */
+ static A2Methods_applyfun *const callbacks[A2_TRANSVERSE + 1] = {
+         [A2_ROTATE_0]        = rotate_0,
+         [A2_ROTATE_90]       = rotate_90,
+         [A2_ROTATE_180]      = rotate_180,
+         [A2_ROTATE_270]      = rotate_270,
+         [A2_FLIP_HORIZONTAL] = horizontal_flip,
+         [A2_FLIP_VERTICAL]   = vertical_flip,
+         [A2_TRANSPOSE]       = transpose,
+         [A2_TRANSVERSE]      = transverse,
+ };
+
+ /* the transform for a -rotate angle main() has already checked */
+ static A2Transform_T rotation_kind(int rotation)
  {
-        fprintf(stderr, "rotation: %d\n", rotation);
+         switch (rotation) {
+         case 90:  return A2_ROTATE_90;
+         case 180: return A2_ROTATE_180;
+         case 270: return A2_ROTATE_270;
+         default:  return A2_ROTATE_0;
+         }
+ }
 
-         if (flip_type == NULL) {
-                 if (rotation == 90) {
-                         /* map with the called for order, array is pixel array 
-                         from the Pnm_ppm struct*/
-                         map(image->pixels, rotate_90, &cl);
-         
-                         new_image->width = height;   /*update rotated image*/
-                         new_image->height = width;
-                 } else if (rotation == 180) { 
-                         map(image->pixels, rotate_180, &cl);
-         
-                         new_image->width = width;  
-                         new_image->height = height;
-                 } else if (rotation == 270) {
-                         map(image->pixels, rotate_270, &cl);
-                         
-                         new_image->width = height;  
-                         new_image->height = width;
-                 } else if (rotation == 0) {
-                        map(image->pixels, rotate_0, &cl);
-                         
-                        new_image->width = width;  
-                        new_image->height = height;
-                 } 
-         } else {
-                 if (strcmp(flip_type, "horizontal") == 0) {
-                         map(image->pixels, horizontal_flip, &cl);
- 
-                         new_image->width = width;  
-                         new_image->height = height;
-                 } else if (strcmp(flip_type, "vertical") == 0) {
-                         map(image->pixels, vertical_flip, &cl);
+ /* adds step to the end of a chain kept both as one transform and as 
+ one matrix */
+ static void chain(A2Transform_T *kind, A2Affine *matrix, A2Transform_T step)
+ {
+         *kind = A2Transform_compose(*kind, step);
+         *matrix = A2Affine_compose(*matrix, A2Affine_of(step));
+ }
+
+ /* the suite's own implementation of 'kind', or NULL if it has none */
+ static A2Methods_transformfun *native_transform(A2Methods_T methods,
+                                                 A2Transform_T kind)
+ {
+         switch (kind) {
+         case A2_ROTATE_90:       return methods->rotate90;
+         case A2_ROTATE_180:      return methods->rotate180;
+         case A2_ROTATE_270:      return methods->rotate270;
+         case A2_FLIP_HORIZONTAL: return methods->flip_h;
+         case A2_FLIP_VERTICAL:   return methods->flip_v;
+         case A2_TRANSPOSE:       return methods->transpose;
+         case A2_TRANSVERSE:      return methods->transverse;
+         default:                 return NULL;
+         }
+ }
+
+ /* the suites whose storage the transform engine can work on directly */
+ static bool is_built_in(A2Methods_T methods)
+ {
+         return methods == uarray2_methods_plain 
+                || methods == uarray2_methods_blocked;
+ }
+
+ /* the traversal a built-in suite's map function stands for */
+ A2Traversal_T traversal_of(A2Methods_T methods, A2Methods_mapfun *map)
+ {
+         if (map == methods->map_col_major) {
+                 return A2_COL_MAJOR;
+         } else if (map == methods->map_block_major) {
+                 return A2_BLOCK_MAJOR;
+         }
+         return A2_ROW_MAJOR;
+ }
+
+ /* the map of methods for a traversal, NULL if it has none */
+ A2Methods_mapfun *map_of(A2Methods_T methods, A2Traversal_T order)
+ {
+         switch (order) {
+         case A2_COL_MAJOR:   return methods->map_col_major;
+         case A2_BLOCK_MAJOR: return methods->map_block_major;
+         default:             return methods->map_row_major;
+         }
+ }
+
+ /* names of the transforms and traversals in -benchmark and -phases 
+ output */
+ const char *const kind_names[] = {
+         [A2_ROTATE_0]        = "rotate-0",
+         [A2_ROTATE_90]       = "rotate-90",
+         [A2_ROTATE_180]      = "rotate-180",
+         [A2_ROTATE_270]      = "rotate-270",
+         [A2_FLIP_HORIZONTAL] = "flip-horizontal",
+         [A2_FLIP_VERTICAL]   = "flip-vertical",
+         [A2_TRANSPOSE]       = "transpose",
+         [A2_TRANSVERSE]      = "transverse",
+ };
+
+ const char *const traversal_names[] = {
+         [A2_ROW_MAJOR]   = "row-major",
+         [A2_COL_MAJOR]   = "col-major",
+         [A2_BLOCK_MAJOR] = "block-major",
+ };
+
+ /********** transform_into ********
+  *
+  * Writes the transformed image of pixels into transImage
+  *
+  * Parameters:
+  *      A2Methods_T methods: the suite both arrays were made with
+  *      A2Methods_mapfun *map: traversal to use
+  *      A2Transform_T kind: the transform to apply
+  *      A2 pixels: the source image
+  *      A2 transImage: an array of the transformed dimensions; every 
+  *                     cell is overwritten
+  *
+  * Return: 
+  *      None
+  *
+  * Notes:
+  *      Built-in suites go through the transform engine's kernel for 
+  *      the traversal; anything else maps the per-pixel callback
+  ************************/
+ void transform_into(A2Methods_T methods, A2Methods_mapfun *map,
+                     A2Transform_T kind, A2 pixels, A2 transImage)
+ {
+         A2Layout src, dst;
+
+         if (is_built_in(methods) && A2Layout_of(methods, pixels, &src)
+             && A2Layout_of(methods, transImage, &dst)) {
+                 A2Transform_traverse(kind, traversal_of(methods, map), 
+                                      src, dst);
+                 return;
+         }
+
+         struct Closure cl = {transImage, methods, methods->size(pixels)};
+
+         assert(callbacks[kind] != NULL);
+         map(pixels, callbacks[kind], &cl);
+ }
+
+ /********** fit_plan ********
+  *
+  * Makes *plan a plan for transforming pixels into transImage, keeping 
+  * the one there if it fits them
+  *
+  * Parameters:
+  *      A2Plan_T *plan: the plan, or NULL if there is none yet
+  *      A2Methods_T methods: the suite both arrays were made with
+  *      A2Methods_mapfun *map: traversal the plan is to follow
+  *      A2Transform_T kind: the transform to plan
+  *      A2 pixels: the source image
+  *      A2 transImage: an array of the transformed dimensions
+  *
+  * Return: 
+  *      true if *plan can be used; false, with *plan as it was, if the 
+  *      suite's storage is not one the transform engine can see, or if 
+  *      a plan would have no tables to offer
+  *
+  * Notes:
+  *      A plan only holds the shapes of the arrays, so one made for an 
+  *      earlier image serves every later one of the same size, and is 
+  *      only rebuilt when the size changes.  The kind and traversal 
+  *      must be those *plan was made with.  No plan is made for a plain
+  *      array, whose kernel is already a multiply-add per cell, or for
+  *      a transform and traversal one of the engines handles, since 
+  *      A2Plan would only run the same code; the caller transforms as
+  *      it would without -plan.
+  ************************/
+ bool fit_plan(A2Plan_T *plan, A2Methods_T methods, 
+               A2Methods_mapfun *map, A2Transform_T kind, A2 pixels, 
+               A2 transImage)
+ {
+         A2Layout src, dst;
+
+         if (!is_built_in(methods) || !A2Layout_of(methods, pixels, &src)
+             || !A2Layout_of(methods, transImage, &dst)) {
+                 return false;
+         }
+         A2Traversal_T order = traversal_of(methods, map);
+         if (src.blocksize == 1 || dst.blocksize == 1
+             || A2Transform_has_engine(kind, order, src.size)) {
+                 return false;
+         }
+         if (*plan != NULL && A2Plan_fits(*plan, src, dst)) {
+                 return true;
+         }
+         if (*plan != NULL) {
+                 A2Plan_free(plan);
+         }
+         *plan = A2Plan_new(kind, order, src, dst);
+         return true;
+ }
+
+ /* transform_into through a plan fit_plan has made for the two arrays */
+ void planned_transform_into(A2Plan_T plan, A2Methods_T methods, 
+                             A2 pixels, A2 transImage)
+ {
+         A2Layout src, dst;
+
+         bool raw = A2Layout_of(methods, pixels, &src)
+                    && A2Layout_of(methods, transImage, &dst);
+         assert(raw);
+         A2Plan_execute(plan, src, dst);
+ }
+
+ /********** trace_transform_into ********
+  *
+  * transform_into, recording every cell it touches in the -trace file
+  *
+  * Parameters:
+  *      const struct Options *options: the suite, traversal, transform 
+  *                                     and trace file
+  *      A2 pixels: the source image
+  *      A2 transImage: an array of the transformed dimensions
+  *
+  * Return: 
+  *      None
+  *
+  * Notes:
+  *      The transform runs over an A2Watch wrapping of the suite, which
+  *      has no native transforms, so it goes through the per-pixel 
+  *      callbacks and the trace shows exactly what they do.  A trace 
+  *      file that cannot be opened is reported and the program exits.
+  ************************/
+ static void trace_transform_into(const struct Options *options, A2 pixels,
+                                  A2 transImage)
+ {
+         A2Methods_T methods = options->methods;
+         FILE *out = fopen(options->trace_file_name, "wb");
+         if (out == NULL) {
+                 perror(options->trace_file_name);
+                 exit(EXIT_FAILURE);
+         }
+
+         A2Trace_T trace = A2Trace_new(out);
+         A2Methods_T watched = A2Watch_methods(methods, A2Trace_observe, 
+                                               trace);
+         A2Trace_array(trace, SOURCE, methods, pixels);
+         A2Trace_array(trace, DESTINATION, methods, transImage);
+         transform_into(watched, 
+                        map_of(watched, traversal_of(methods, options->map)),
+                        options->kind, pixels, transImage);
+         A2Trace_free(&trace);
+         fclose(out);
+ }
+
+ /********** rotation_flip ********
+  *
+  * Produces the transformed copy of an image's pixels
+  *
+  * Parameters:
+  *      A2Methods_T methods: the suite the pixels were made with
+  *      A2Methods_mapfun *map: traversal to use
+  *      A2Transform_T kind: the transform to apply
+  *      A2 pixels: the source image
+  *
+  * Return: 
+  *      a new array holding the transformed image
+  *
+  * Notes:
+  *      For the built-in suites the kernel generated for this
+  *      representation, transform and traversal does the copy with no
+  *      function-pointer calls per pixel.  Any other suite uses its
+  *      native transform if it has one, or is mapped through the
+  *      per-pixel callbacks.
+  ************************/
+ static A2 rotation_flip(A2Methods_T methods, A2Methods_mapfun *map,
+                         A2Transform_T kind, A2 pixels)
+ {
+         int new_width, new_height;
+         A2Transform_dims(kind, methods->width(pixels), 
+                          methods->height(pixels), &new_width, &new_height);
+
+         A2Methods_transformfun *native = native_transform(methods, kind);
+         if (!is_built_in(methods) && native != NULL) {
+                 return native(pixels);
+         }
+
+         A2 transImage = methods->new_with_blocksize(new_width, new_height,
+                                         methods->size(pixels),
+                                         methods->blocksize(pixels));
+         transform_into(methods, map, kind, pixels, transImage);
+         return transImage;
+ }
  
-                         new_image->width = width;  
-                         new_image->height = height;
+ /* true if the pixels are resampled rather than moved: the image is 
+ shrunk, or goes through a matrix */
+ bool resamples(const struct Options *options)
+ {
+         return options->warp || options->scale > 1;
+ }
+
+ /* width and height of the image the command line turns a width x height 
+ image into */
+ void result_dims(const struct Options *options, int width, 
+                  int height, int *new_width, int *new_height)
+ {
+         A2Transform_reduced_dims(options->scale, width, height, &width, 
+                                  &height);
+         if (options->warp) {
+                 A2Affine_dims(options->matrix, width, height, new_width,
+                               new_height);
+         } else {
+                 A2Transform_dims(options->kind, width, height, new_width,
+                                  new_height);
+         }
+ }
+
+ /********** resample_into ********
+  *
+  * Shrinks pixels by -scale and resamples them through the -angle/
+  * -affine matrix into transImage, whichever of the two were asked for
+  *
+  * Parameters:
+  *      const struct Options *options: the factor, kind, matrix and 
+  *                                     sampling
+  *      A2 pixels: the source image
+  *      A2 transImage: an array of the dimensions result_dims gives; 
+  *                     every cell is overwritten
+  *
+  * Return: 
+  *      None
+  *
+  * Expects:
+  *      both arrays made by a built-in suite (checked runtime error)
+  *
+  * Notes:
+  *      A shrink with one of the eight transforms is a single pass that 
+  *      writes each averaged cell straight to its transformed place.  
+  *      A shrink before a warp goes through a reduced copy, so the warp 
+  *      samples averaged cells and reads only the small image.
+  ************************/
+ void resample_into(const struct Options *options, A2 pixels, 
+                    A2 transImage)
+ {
+         A2Methods_T methods = options->methods;
+         A2Layout src, dst;
+
+         bool raw = is_built_in(methods) 
+                    && A2Layout_of(methods, pixels, &src)
+                    && A2Layout_of(methods, transImage, &dst);
+         assert(raw);
+
+         if (!options->warp) {
+                 A2Transform_reduce(options->kind, options->scale, src, 
+                                    dst);
+                 return;
+         }
+         if (options->scale == 1) {
+                 A2Affine_apply(options->matrix, options->sampling, src, 
+                                dst);
+                 return;
+         }
+
+         int width, height;
+         A2Layout small;
+         A2Transform_reduced_dims(options->scale, src.width, src.height, 
+                                  &width, &height);
+         A2 reduced = methods->new_with_blocksize(width, height, 
+                                         sizeof(struct Pnm_rgb),
+                                         methods->blocksize(pixels));
+         raw = A2Layout_of(methods, reduced, &small);
+         assert(raw);
+         A2Transform_reduce(A2_ROTATE_0, options->scale, src, small);
+         A2Affine_apply(options->matrix, options->sampling, small, dst);
+         methods->free(&reduced);
+ }
+
+ /* the largest -blocksize accepted; a block of Pnm_rgb this size is 
+ about 3MB */
+ #define MAX_BLOCKSIZE 512
+
+ /* the most threads -threads accepts */
+ #define MAX_THREADS 256
+
+ /* one thread's part of a parallel transform: a band of source rows */
+ struct Share {
+         A2Transform_T kind;
+         A2Traversal_T order;
+         A2Layout src, dst;
+         A2Plan_T plan;          /* NULL to use the kernel */
+         int row_lo, row_hi;
+         double time_used;       /* CPU time of the thread that did it */
+         pthread_t thread;
+ };
+
+ static void *transform_share(void *cl)
+ {
+         struct Share *share = cl;
+         CPUTime_T timer = CPUTime_NewThread();
+
+         CPUTime_Start(timer);
+         if (share->plan != NULL) {
+                 A2Plan_execute_rows(share->plan, share->src, share->dst, 
+                                     share->row_lo, share->row_hi);
+         } else {
+                 A2Transform_traverse_rows(share->kind, share->order, 
+                                           share->src, share->dst, 
+                                           share->row_lo, share->row_hi);
+         }
+         share->time_used = CPUTime_Stop(timer);
+
+         CPUTime_Free(&timer);
+         return NULL;
+ }
+
+ /********** parallel_transform_into ********
+  *
+  * transform_into spread over options->threads threads
+  *
+  * Parameters:
+  *      const struct Options *options: the suite, traversal, transform 
+  *                                     and thread count
+  *      A2 pixels: the source image
+  *      A2 transImage: an array of the transformed dimensions
+  *      A2Plan_T plan: a plan fit_plan made for the two arrays, or NULL
+  *      struct Share shares[]: room for MAX_THREADS shares, filled in 
+  *                             with each thread's rows and time
+  *      int *nshares: set to the number of shares used
+  *
+  * Return: 
+  *      None
+  *
+  * Notes:
+  *      The source is cut into bands of whole tiles (whole blocks for a
+  *      blocked array), one per thread, and each thread transforms its
+  *      band with the same kernel, or plan, the serial path uses.  A 
+  *      transform moves distinct cells to distinct cells, so the threads
+  *      write disjoint parts of the destination and need no locking.  The 
+  *      calling thread does the first band itself.  Suites other than 
+  *      the built-in ones go through transform_into alone.
+  ************************/
+ static void parallel_transform_into(const struct Options *options, 
+                                     A2 pixels, A2 transImage, A2Plan_T plan,
+                                     struct Share shares[], int *nshares)
+ {
+         A2Methods_T methods = options->methods;
+         A2Transform_T kind = options->kind;
+         int height = methods->height(pixels);
+
+         A2Layout src, dst;
+         *nshares = 0;
+         if (!is_built_in(methods) || !A2Layout_of(methods, pixels, &src)
+             || !A2Layout_of(methods, transImage, &dst)) {
+                 transform_into(methods, options->map, kind, pixels, 
+                                transImage);
+                 return;
+         }
+
+         int grain = A2Transform_grain(src);
+         int tiles = (height + grain - 1) / grain;
+         int n = options->threads < tiles ? options->threads : tiles;
+
+         for (int t = 0; t < n; t++) {
+                 struct Share *share = &shares[t];
+                 share->kind = kind;
+                 share->order = traversal_of(methods, options->map);
+                 share->src = src;
+                 share->dst = dst;
+                 share->plan = plan;
+                 share->row_lo = (int)((long)tiles * t / n) * grain;
+                 share->row_hi = (int)((long)tiles * (t + 1) / n) * grain;
+                 if (share->row_hi > height) {
+                         share->row_hi = height;
                  }
          }
+         for (int t = 1; t < n; t++) {
+                 int error = pthread_create(&shares[t].thread, NULL,
+                                            transform_share, &shares[t]);
+                 assert(error == 0);
+                 (void)error;
+         }
+         transform_share(&shares[0]);
+         for (int t = 1; t < n; t++) {
+                 pthread_join(shares[t].thread, NULL);
+         }
+
+         *nshares = n;
  }
- 
+
+ /********** can_transform_in_place ********
+  *
+  * Parameters:
+  *      A2Methods_T methods: the suite the image was made with
+  *      A2Transform_T kind: the transform
+  *      int width, height: dimensions of the image
+  *
+  * Return: 
+  *      true if transform_in_place can handle this combination
+  *
+  * Notes:
+  *      Any suite can swap symmetric pairs through methods->at.  The
+  *      built-in suites also do square quarter turns, and a blocked
+  *      array can take the new shape of a non-square quarter turn
+  *      (UArray2b_reshape).  UArray2 has no way to change shape, so a
+  *      plain non-square quarter turn still needs a second array.
+  ************************/
+ bool can_transform_in_place(A2Methods_T methods, A2Transform_T kind,
+                             int width, int height)
+ {
+         bool involution = kind == A2_ROTATE_0 || kind == A2_ROTATE_180
+                           || kind == A2_FLIP_HORIZONTAL 
+                           || kind == A2_FLIP_VERTICAL
+                           || ((kind == A2_TRANSPOSE || kind == A2_TRANSVERSE)
+                               && width == height);
+
+         if (!is_built_in(methods)) {
+                 return involution;
+         }
+         return A2Transform_in_place_ok(kind, width, height)
+                || methods == uarray2_methods_blocked;
+ }
+
+ /********** transform_in_place ********
+  *
+  * Applies a transform to an image's own pixels, without a second array
+  *
+  * Parameters:
+  *      A2Methods_T methods: the suite the pixels were made with
+  *      A2Transform_T kind: the transform, one can_transform_in_place
+  *                          accepts
+  *      Pnm_ppm image: the image, overwritten with the result (its
+  *                     width and height are updated)
+  *
+  * Return: 
+  *      None
+  *
+  * Notes:
+  *      Built-in suites swap cells straight through their layout, and a
+  *      non-square quarter turn follows the permutation's cycles with a
+  *      one-bit-per-pixel visited map.  For any other suite each
+  *      symmetric pair is swapped through methods->at, once, when
+  *      visiting the earlier cell of the pair.
+  ************************/
+ void transform_in_place(A2Methods_T methods, A2Transform_T kind,
+                         Pnm_ppm image)
+ {
+         A2 pixels = image->pixels;
+         int width = methods->width(pixels);
+         int height = methods->height(pixels);
+         int new_width, new_height;
+         A2Transform_dims(kind, width, height, &new_width, &new_height);
+         image->width = new_width;
+         image->height = new_height;
+
+         A2Layout layout;
+         if (is_built_in(methods) && A2Layout_of(methods, pixels, &layout)) {
+                 if (A2Transform_in_place_ok(kind, width, height)) {
+                         A2Transform_in_place(kind, layout);
+                 } else {
+                         assert(methods == uarray2_methods_blocked);
+                         A2Transform_in_place_cycles(kind, layout);
+                         UArray2b_reshape(pixels, new_width, new_height);
+                 }
+                 return;
+         }
+
+         for (int row = 0; row < height; row++) {
+                 for (int col = 0; col < width; col++) {
+                         int new_col, new_row;
+                         A2Transform_at(kind, width, height, col, row,
+                                        &new_col, &new_row);
+                         if (new_row < row 
+                             || (new_row == row && new_col <= col)) {
+                                 continue;
+                         }
+                         Pnm_rgb a = methods->at(pixels, col, row);
+                         Pnm_rgb b = methods->at(pixels, new_col, new_row);
+                         struct Pnm_rgb tmp = *a;
+                         *a = *b;
+                         *b = tmp;
+                 }
+         }
+ }
+
  /*****************************************************************
   *                     Other useful functions
   *****************************************************************/
- static void write_the_timing(const char *time_file_name, double time_used, int width, int height) {
+
+ /* the name -phases gives the suite of an array */
+ const char *suite_name(A2Methods_T methods)
+ {
+         return methods == uarray2_methods_blocked ? "blocked" : "plain";
+ }
+
+ /* bytes in a -memory argument such as 4096, 512K or 2G; 0 if malformed */
+ static size_t parse_memory(const char *text)
+ {
+         char *end;
+         unsigned long long n = strtoull(text, &end, 10);
+         if (end == text || *text == '-') {
+                 return 0;
+         }
+
+         int shift = 0;
+         switch (*end) {
+         case '\0':           break;
+         case 'K': case 'k': shift = 10; end++; break;
+         case 'M': case 'm': shift = 20; end++; break;
+         case 'G': case 'g': shift = 30; end++; break;
+         default:            return 0;
+         }
+         if (*end != '\0' || n > (SIZE_MAX >> shift)) {
+                 return 0;
+         }
+         return (size_t)n << shift;
+ }
+ void write_the_timing(const char *time_file_name, double time_used, 
+                       int width, int height) {
          // Validate input parameters
          if (time_file_name == NULL) {
              fprintf(stderr, "Error: time_file_name is NULL\n");
@@ -406,91 +1089,482 @@
      
          // Write data to file
          fprintf(timings_file, "Time taken per pixel: %.0f nanoseconds\n", time_per_pix);
-         fprintf(stderr, "Before closing the timings_file\n");
      
          // Close the file safely
          fclose(timings_file);
      }
  
- static void execution(FILE *fp, A2Methods_T methods, A2Methods_mapfun *map, int rotation, 
-                 char *flip_type, CPUTime_T timer, char *time_file_name, double time_used)
+ /* one line per thread of a parallel transform, with the CPU time of 
+ that thread, after the usual line */
+ static void write_thread_timings(const char *time_file_name, 
+                                  const struct Share shares[], int nshares,
+                                  int width)
  {
-         Pnm_ppm image = Pnm_ppmread(fp, methods); 
+         if (nshares == 0) {
+                 return;
+         }
+         FILE *timings_file = fopen(time_file_name, "a");
+         if (timings_file == NULL) {
+                 perror("Error opening file");
+                 return;
+         }
+         for (int t = 0; t < nshares; t++) {
+                 int rows = shares[t].row_hi - shares[t].row_lo;
+                 double pixels = (double)rows * width;
+                 fprintf(timings_file, "Thread %d: rows %d-%d, %.0f "
+                         "nanoseconds, %.0f nanoseconds per pixel\n", t,
+                         shares[t].row_lo, shares[t].row_hi - 1,
+                         shares[t].time_used,
+                         pixels > 0 ? shares[t].time_used / pixels : 0.0);
+         }
+         fclose(timings_file);
+ }
+
+ /* narrows stream to the -crop rectangle, if there is one; false if the 
+ rectangle does not fit in the image, leaving the stream as it was */
+ bool crop_stream(const struct Options *options, Ppmstream_T stream)
+ {
+         if (!options->crop) {
+                 return true;
+         }
+         unsigned width = Ppmstream_width(stream);
+         unsigned height = Ppmstream_height(stream);
+         if (options->crop_x >= width 
+             || options->crop_width > width - options->crop_x
+             || options->crop_y >= height 
+             || options->crop_height > height - options->crop_y) {
+                 return false;
+         }
+         Ppmstream_crop(stream, options->crop_x, options->crop_y, 
+                        options->crop_width, options->crop_height);
+         return true;
+ }
+
+ /* exits with a message if an image with this magic number (from 
+ Ppmstream_read_magic) is to be cropped and is not a P6; only the binary
+ format can skip the rows above the rectangle unread */
+ static void raw_crop_or_exit(const struct Options *options, int magic)
+ {
+         if (options->crop && magic != '6') {
+                 fprintf(stderr, "-crop needs a binary (P6) image\n");
+                 exit(EXIT_FAILURE);
+         }
+ }
+
+ /* crop_stream, reporting a crop that does not fit and exiting */
+ static void crop_or_exit(const struct Options *options, Ppmstream_T stream)
+ {
+         if (!crop_stream(options, stream)) {
+                 fprintf(stderr, "Crop %u,%u,%u,%u does not fit in the "
+                         "%ux%u image\n", options->crop_x, options->crop_y,
+                         options->crop_width, options->crop_height,
+                         Ppmstream_width(stream), Ppmstream_height(stream));
+                 exit(EXIT_FAILURE);
+         }
+ }
+
+ /* true if images whose denominator fits are held in packed pixels.  
+ Resampling does arithmetic on Pnm_rgb channels, so it never packs */
+ static bool packs(const struct Options *options)
+ {
+         return !options->unpacked && !resamples(options) 
+                && is_built_in(options->methods);
+ }
+
+ /* bytes in each pixel of an image with this denominator: a packed 
+ Ppmstream_rgb8 where it fits, otherwise a Pnm_rgb */
+ int pixel_size(const struct Options *options, unsigned denominator)
+ {
+         if (packs(options) && denominator <= PPMSTREAM_PACKED_MAX) {
+                 return sizeof(struct Ppmstream_rgb8);
+         }
+         return sizeof(struct Pnm_rgb);
+ }
+
+ /* a width x height array of pixels of 'size' bytes in the chosen suite,
+ with the -blocksize if one was given */
+ A2 new_pixels(const struct Options *options, int width, int height,
+               int size)
+ {
+         if (options->blocksize > 0) {
+                 return options->methods->new_with_blocksize(width, height,
+                                                             size,
+                                                             options->blocksize);
+         }
+         return options->methods->new(width, height, size);
+ }
+
+ /* writes image to stdout as a P6, packed pixels or not */
+ static void write_image(Pnm_ppm image)
+ {
+         A2Methods_T methods = image->methods;
+         if (methods->size(image->pixels) == sizeof(struct Pnm_rgb)) {
+                 Pnm_ppmwrite(stdout, image);
+         } else {
+                 Ppmstream_write_pixels(stdout, methods, image->pixels,
+                                        image->denominator);
+         }
+ }
+
+ /* Pnm_ppmread of an image ppmstream cannot read, such as a P3, with its 
+ pixels moved into an array of the chosen suite, block size and pixel 
+ size */
+ static Pnm_ppm read_other_image(FILE *fp, const struct Options *options)
+ {
+         Pnm_ppm image = Pnm_ppmread(fp, uarray2_methods_plain);
+         A2 pixels = new_pixels(options, image->width, image->height,
+                                pixel_size(options, image->denominator));
+
+         Ppmstream_copy_pixels(image->methods, image->pixels, 
+                               options->methods, pixels);
+         image->methods->free(&image->pixels);
+         image->pixels = pixels;
+         image->methods = options->methods;
+         return image;
+ }
+
+ /********** read_image ********
+  *
+  * Reads the image, or just its -crop rectangle, into an array of the 
+  * chosen suite and block size
+  *
+  * Parameters:
+  *      FILE *fp: the input
+  *      const struct Options *options: the suite and the crop
+  *      struct Phases *phases: where to add the parse and alloc times, 
+  *                             or NULL
+  *
+  * Return: 
+  *      the image, to be freed with Pnm_ppmfree
+  *
+  * Notes:
+  *      Without a crop, a -blocksize, -phases or pixels that could be 
+  *      packed this is Pnm_ppmread, whose blocked arrays always take the
+  *      default 64KB blocks; the pixels are packed (see pixel_size) 
+  *      whenever the denominator allows.  With a crop the rows above the
+  *      rectangle are skipped, the rows below it never read, and only 
+  *      the rectangle is decoded, into an array of its size, so the 
+  *      transform that follows only ever sees the pixels it keeps.
+  *      Reading the header and decoding the pixels count as parsing, 
+  *      making the array as allocation.  Any other format than P6 is 
+  *      read by Pnm_ppmread and then copied into such an array, all of 
+  *      it counted as parsing, since Pnm_ppmread allocates as it goes.
+  ************************/
+ Pnm_ppm read_image(FILE *fp, const struct Options *options,
+                    struct Phases *phases)
+ {
+         if (!options->crop && options->blocksize == 0 && phases == NULL
+             && !packs(options)) {
+                 return Pnm_ppmread(fp, options->methods);
+         }
+         int magic = Ppmstream_read_magic(fp);
+         if (magic != '6') {
+                 raw_crop_or_exit(options, magic);
+                 Phases_start(phases);
+                 FILE *whole = Ppmstream_unread_magic(fp, magic);
+                 Pnm_ppm image = read_other_image(whole, options);
+                 if (whole != fp) {
+                         fclose(whole);
+                 }
+                 Phases_stop(phases, PHASE_PARSE);
+                 return image;
+         }
+
+         Phases_start(phases);
+         Ppmstream_T stream = Ppmstream_open_after_magic(fp);
+         crop_or_exit(options, stream);
+         Phases_stop(phases, PHASE_PARSE);
+
+         Phases_start(phases);
+         Pnm_ppm image = malloc(sizeof(*image));
+         assert(image != NULL);
+         image->width = Ppmstream_width(stream);
+         image->height = Ppmstream_height(stream);
+         image->denominator = Ppmstream_denominator(stream);
+         image->methods = options->methods;
+         image->pixels = new_pixels(options, image->width, image->height,
+                                    pixel_size(options, 
+                                               image->denominator));
+         Phases_stop(phases, PHASE_ALLOC);
+
+         Phases_start(phases);
+         Ppmstream_read_pixels(stream, options->methods, image->pixels);
+         Ppmstream_free(&stream);
+         Phases_stop(phases, PHASE_PARSE);
+         return image;
+ }
+
+ /********** stream_execution ********
+  *
+  * Transforms the image in fp a row at a time, never building an A2
+  *
+  * Parameters:
+  *      FILE *fp: the input image, a P6 whose magic number has been 
+  *                read
+  *      const struct Options *options: the transform (one 
+  *                                     Ppmstream_can_transform accepts),
+  *                                     memory budget and time file
+  *      CPUTime_T timer: timer for -time
+  *      struct Phases *phases: the -phases times so far, or NULL
+  *      const char *path: the input file for -phases, NULL for stdin
+  *
+  * Return: 
+  *      None
+  *
+  * Notes:
+  *      Reading, transforming and writing are interleaved, so the time 
+  *      recorded covers all three, and for -phases so does the 
+  *      transform phase; parsing is the header alone.
+  ************************/
+ static void stream_execution(FILE *fp, const struct Options *options, 
+                              CPUTime_T timer, struct Phases *phases,
+                              const char *path)
+ {
+         Phases_start(phases);
+         Ppmstream_T stream = Ppmstream_open_after_magic(fp);
+         crop_or_exit(options, stream);
+         int width = Ppmstream_width(stream);
+         int height = Ppmstream_height(stream);
+         Phases_stop(phases, PHASE_PARSE);
+
+         Phases_start(phases);
+         CPUTime_Start(timer);
+         Ppmstream_transform(options->kind, stream, stdout, 
+                             options->memory);
+         double time_used = CPUTime_Stop(timer);
+         Phases_stop(phases, PHASE_TRANSFORM);
+
+         if (options->time_file_name != NULL) {
+                 write_the_timing(options->time_file_name, time_used, width,
+                                  height);
+         }
+
+         Phases_start(phases);
+         fflush(stdout);
+         Phases_stop(phases, PHASE_WRITE);
+
+         Phases_start(phases);
+         Ppmstream_free(&stream);
+         CPUTime_Free(&timer);
+         fclose(fp);
+         Phases_stop(phases, PHASE_FREE);
+
+         if (phases != NULL) {
+                 Phases_write(options, phases, path, "stream", 0, width, 
+                              height);
+         }
+ }
+
+ /********** execution ********
+  *
+  * Transforms the image in fp through an array of the chosen suite and 
+  * writes it to stdout
+  *
+  * Parameters:
+  *      FILE *fp: the input image
+  *      const struct Options *options: everything asked for
+  *      CPUTime_T timer: timer for -time
+  *      struct Phases *phases: the -phases times so far, or NULL
+  *      const char *path: the input file for -phases, NULL for stdin
+  *
+  * Return: 
+  *      None
+  *
+  * Notes:
+  *      The destination is made before the timer starts whenever the 
+  *      suite allows it, so -time covers the transform alone.  Only a 
+  *      suite of someone else's, whose native transforms make their own
+  *      arrays, has its allocation counted as part of the transform.
+  *      A -plan is made with the destination, and counts as allocation.
+  *      With -threads the timer main passes is a wall-clock one, so the
+  *      usual line shows how long the transform took, and each thread's
+  *      own CPU time follows it.
+  ************************/
+ static void execution(FILE *fp, const struct Options *options, 
+                       CPUTime_T timer, struct Phases *phases, 
+                       const char *path)
+ {
+         A2Methods_T methods = options->methods;
+         A2Transform_T kind = options->kind;
+         char *time_file_name = options->time_file_name;
+         double time_used;
+
+         Pnm_ppm image = read_image(fp, options, phases); 
          
          /* grab information about image */
          int width = image->width;
          int height = image->height;
-         
-         A2 transImage = NULL; /*instance of new image*/
+         int blocksize = methods->blocksize(image->pixels);
+
+         /* with -in-place the image is its own destination and no second 
+         array is ever allocated, whenever the suite and shape allow it */
+         if (options->in_place && !resamples(options)
+             && options->trace_file_name == NULL
+             && can_transform_in_place(methods, kind, width, height)) {
+                 Phases_start(phases);
+                 CPUTime_Start(timer);
+                 transform_in_place(methods, kind, image);
+                 time_used = CPUTime_Stop(timer);
+                 Phases_stop(phases, PHASE_TRANSFORM);
+
+                 if (time_file_name != NULL) {
+                         write_the_timing(time_file_name, time_used, width, 
+                                          height);
+                 }
+                 Phases_start(phases);
+                 write_image(image);
+                 fflush(stdout);
+                 Phases_stop(phases, PHASE_WRITE);
+
+                 Phases_start(phases);
+                 CPUTime_Free(&timer);
+                 Pnm_ppmfree(&image);
+                 fclose(fp);
+                 Phases_stop(phases, PHASE_FREE);
+                 if (phases != NULL) {
+                         Phases_write(options, phases, path, 
+                                      suite_name(methods), blocksize, width,
+                                      height);
+                 }
+                 return;
+         }
          
          /* Create a new Pnm_ppm struct for the rotated image */
+         Phases_start(phases);
          Pnm_ppm new_image = malloc(sizeof(*new_image));
          assert(new_image != NULL);
- 
-         int blocksize = methods->blocksize(image->pixels);
- 
-         /* create new array */
-         if (rotation == 90 || rotation == 270) {
-                 transImage = methods->new_with_blocksize(height, width, 
-                                         sizeof(struct Pnm_rgb), blocksize);
-         } 
-         else if (rotation == 180 || rotation == 0) {
-                 transImage = methods->new_with_blocksize(width, height, 
-                                         sizeof(struct Pnm_rgb), blocksize);
+
+         int new_width, new_height;
+         result_dims(options, width, height, &new_width, &new_height);
+         A2 transImage = NULL;
+         if (resamples(options) || is_built_in(methods)) {
+                 transImage = methods->new_with_blocksize(new_width, 
+                                         new_height, 
+                                         methods->size(image->pixels),
+                                         blocksize);
          }
- 
-         /* create instance of struct with our new array */
-         struct Closure cl = {transImage, methods};
- 
+         A2Plan_T plan = NULL;
+         if (options->plan && transImage != NULL && !resamples(options)
+             && options->trace_file_name == NULL) {
+                 fit_plan(&plan, methods, options->map, kind, image->pixels,
+                          transImage);
+         }
+         Phases_stop(phases, PHASE_ALLOC);
+
+         Phases_start(phases);
          CPUTime_Start(timer); /*start timer*/
- 
-         /* Since rotation is set default to 0, if -rotation is not given 
-         but -flip is, rotation will still be 0 */
-         fprintf(stderr, "Before flip\n");
- 
-         rotation_flip(flip_type, map, rotation, width, height, 
-                 image, new_image, cl);
- 
-         fprintf(stderr, "After flip\n");
- 
+
+         struct Share shares[MAX_THREADS];
+         int nshares = 0;
+         if (resamples(options)) {
+                 resample_into(options, image->pixels, transImage);
+         } else if (transImage == NULL) {
+                 transImage = rotation_flip(methods, options->map, kind, 
+                                            image->pixels);
+         } else if (options->trace_file_name != NULL) {
+                 trace_transform_into(options, image->pixels, transImage);
+         } else if (options->threads > 1) {
+                 parallel_transform_into(options, image->pixels, transImage,
+                                         plan, shares, &nshares);
+         } else if (plan != NULL) {
+                 planned_transform_into(plan, methods, image->pixels, 
+                                        transImage);
+         } else {
+                 transform_into(methods, options->map, kind, image->pixels,
+                                transImage);
+         }
+
          time_used = CPUTime_Stop(timer); /*stop timer*/
- 
-         fprintf(stderr, "Before write_the_timing");
- 
+         Phases_stop(phases, PHASE_TRANSFORM);
+
          if (time_file_name != NULL) {
                  write_the_timing(time_file_name, time_used, width, height);
+                 write_thread_timings(time_file_name, shares, nshares, 
+                                      width);
          }
          
-         fprintf(stderr, "After write_the_timing");
          /*update remaining characteristics of rotated image*/
+         new_image->width = new_width;
+         new_image->height = new_height;
          new_image->denominator = image->denominator;
          new_image->pixels = transImage;
          new_image->methods = methods;
  
          /* Write the transformed image in binary format (P6) */
-         Pnm_ppmwrite(stdout, new_image);
- 
-         fprintf(stderr, "Before cleanup\n");
+         Phases_start(phases);
+         write_image(new_image);
+         fflush(stdout);
+         Phases_stop(phases, PHASE_WRITE);
  
+         Phases_start(phases);
          mem_cleanup(image, new_image, fp, timer);
+         if (plan != NULL) {
+                 A2Plan_free(&plan);
+         }
+         Phases_stop(phases, PHASE_FREE);
+         if (phases != NULL) {
+                 Phases_write(options, phases, path, suite_name(methods), 
+                              blocksize, width, height);
+         }
  }
  
  
  /*****************************************************************
   *                        Running program
   *****************************************************************/
- int main(int argc, char *argv[])
+ /********** parse_options ********
+  *
+  * Reads the command line into the options it asks for
+  *
+  * Parameters:
+  *      int argc, char *argv[]: the command line
+  *      char **files: room for argc names, filled in with the input 
+  *                    files in order
+  *      int *nfiles: set to the number of input files
+  *
+  * Return: 
+  *      the options, every default filled in
+  *
+  * Notes:
+  *      An option that is malformed, or that makes no sense with the 
+  *      others, is reported on stderr along with the usage, and the 
+  *      program exits.
+  ************************/
+ static struct Options parse_options(int argc, char *argv[], char **files, 
+                                     int *nfiles)
  {
          char *time_file_name = NULL;
+         char *phases_file_name = NULL;
+         bool  counters       = false;
+         char *trace_file_name = NULL;
+         bool  plan           = false;
+         bool  unpacked       = false;
          int   rotation       = 0;
          int   i;
-         char *flip_type = NULL; 
-
-         int ok = 0;
-         FILE *fp;
-         /* Create a timer*/
-         CPUTime_T timer = CPUTime_New();
-         double time_used = 0; 
+         /* every -rotate, -flip and -transpose so far, folded into one */
+         A2Transform_T kind = A2_ROTATE_0;
+         /* the same, and every -angle and -affine, as one matrix */
+         A2Affine matrix      = A2Affine_identity();
+         bool  warp           = false;
+         A2Sampling_T sampling = A2_BILINEAR;
+         int   scale          = 1;
+         bool  crop           = false;
+         unsigned crop_x = 0, crop_y = 0, crop_width = 0, crop_height = 0;
+         bool  in_place       = false;
+         bool  stream         = false;
+         size_t memory        = PPMSTREAM_DEFAULT_MEMORY;
+         char *outdir         = NULL;
+         long  jobs           = sysconf(_SC_NPROCESSORS_ONLN);
+         int   threads        = 1;
+         bool  benchmark      = false;
+         int   runs           = 7;
+         int   warmups        = 2;
+         bool  json           = false;
+         int   blocksize      = 0;
+         int   sweep_lo = 0, sweep_hi = 0, sweep_step = 1;
+         bool  cachesim       = false;
+         int   ncaches        = 0;
+         Cachesim_level caches[CACHESIM_MAX_LEVELS];
  
          /* default to UArray2 methods */
          A2Methods_T methods = uarray2_methods_plain; 
@@ -505,7 +1579,6 @@
                  if (strcmp(argv[i], "-row-major") == 0) {
                          SET_METHODS(uarray2_methods_plain, map_row_major, 
                                  "row-major");
-                        fprintf(stderr, "hey\n");
                  } else if (strcmp(argv[i], "-col-major") == 0) {
                          SET_METHODS(uarray2_methods_plain, map_col_major, 
                                  "column-major");
@@ -527,6 +1600,7 @@
                          if (!(*endptr == '\0')) {    /* Not a number */
                                  usage(argv[0]);
                          }
+                         chain(&kind, &matrix, rotation_kind(rotation));
                  } else if (strcmp(argv[i], "-flip") == 0) {
                          if (!(i + 1 < argc)) {  /* No flip value provided */
                          usage(argv[0]);
@@ -534,49 +1608,393 @@
                          
                          /*store if horizontal or vertical*/
                          if (strcmp(argv[i + 1], "horizontal") == 0) {
-                                 flip_type = argv[i + 1];  
-                                 fprintf(stderr, "481\n");
- 
+                                 chain(&kind, &matrix, A2_FLIP_HORIZONTAL);
                          } else if (strcmp(argv[i + 1], "vertical") == 0) {
-                                 flip_type = argv[i + 1];  
+                                 chain(&kind, &matrix, A2_FLIP_VERTICAL);
                          } else {
                                  fprintf(stderr, "Flip must be 'horizontal' or" 
                                          "'vertical'\n");
                                  usage(argv[0]);
                          }
                          i++; 
+                 } else if (strcmp(argv[i], "-transpose") == 0) {
+                         chain(&kind, &matrix, A2_TRANSPOSE);
+                 } else if (strcmp(argv[i], "-transverse") == 0) {
+                         chain(&kind, &matrix, A2_TRANSVERSE);
+                 } else if (strcmp(argv[i], "-angle") == 0) {
+                         if (!(i + 1 < argc)) {      /* no angle */
+                                 usage(argv[0]);
+                         }
+                         char *endptr;
+                         double degrees = strtod(argv[++i], &endptr);
+                         if (*endptr != '\0' || !isfinite(degrees)) {
+                                 fprintf(stderr, "Angle must be a number of "
+                                         "degrees\n");
+                                 usage(argv[0]);
+                         }
+                         matrix = A2Affine_compose(matrix, 
+                                         A2Affine_rotation(degrees));
+                         warp = true;
+                 } else if (strcmp(argv[i], "-affine") == 0) {
+                         if (!(i + 1 < argc)) {      /* no matrix */
+                                 usage(argv[0]);
+                         }
+                         A2Affine m;
+                         int used = -1;
+                         sscanf(argv[++i], "%lf,%lf,%lf,%lf%n", &m.a, &m.b, 
+                                &m.c, &m.d, &used);
+                         if (used < 0 || argv[i][used] != '\0') {
+                                 fprintf(stderr, "Affine must be four "
+                                         "numbers a,b,c,d\n");
+                                 usage(argv[0]);
+                         }
+                         matrix = A2Affine_compose(matrix, m);
+                         warp = true;
+                 } else if (strcmp(argv[i], "-interp") == 0) {
+                         if (!(i + 1 < argc)) {      /* no sampling */
+                                 usage(argv[0]);
+                         }
+                         i++;
+                         if (strcmp(argv[i], "nearest") == 0) {
+                                 sampling = A2_NEAREST;
+                         } else if (strcmp(argv[i], "bilinear") == 0) {
+                                 sampling = A2_BILINEAR;
+                         } else {
+                                 fprintf(stderr, "Interp must be 'nearest' "
+                                         "or 'bilinear'\n");
+                                 usage(argv[0]);
+                         }
+                 } else if (strcmp(argv[i], "-scale") == 0) {
+                         if (!(i + 1 < argc)) {      /* no factor */
+                                 usage(argv[0]);
+                         }
+                         char *endptr;
+                         const char *text = argv[++i];
+                         long n = strncmp(text, "1/", 2) == 0 
+                                  ? strtol(text + 2, &endptr, 10) : 0;
+                         if (n < 1 || n > INT32_MAX || *endptr != '\0') {
+                                 fprintf(stderr, "Scale must be 1/N for a "
+                                         "positive whole N\n");
+                                 usage(argv[0]);
+                         }
+                         scale = n;
+                 } else if (strcmp(argv[i], "-crop") == 0) {
+                         if (!(i + 1 < argc)) {      /* no rectangle */
+                                 usage(argv[0]);
+                         }
+                         int used = -1;
+                         sscanf(argv[++i], "%u,%u,%u,%u%n", &crop_x, &crop_y,
+                                &crop_width, &crop_height, &used);
+                         if (used < 0 || argv[i][used] != '\0' 
+                             || *argv[i] == '-' || crop_width == 0 
+                             || crop_height == 0) {
+                                 fprintf(stderr, "Crop must be x,y,w,h with "
+                                         "a positive width and height\n");
+                                 usage(argv[0]);
+                         }
+                         crop = true;
+                 } else if (strcmp(argv[i], "-in-place") == 0) {
+                         in_place = true;
+                 } else if (strcmp(argv[i], "-stream") == 0) {
+                         stream = true;
+                 } else if (strcmp(argv[i], "-memory") == 0) {
+                         if (!(i + 1 < argc)) {      /* no memory budget */
+                                 usage(argv[0]);
+                         }
+                         memory = parse_memory(argv[++i]);
+                         if (memory == 0) {
+                                 fprintf(stderr, "Memory must be a positive "
+                                         "number of bytes, optionally "
+                                         "followed by K, M or G\n");
+                                 usage(argv[0]);
+                         }
+                 } else if (strcmp(argv[i], "-outdir") == 0) {
+                         if (!(i + 1 < argc)) {      /* no directory */
+                                 usage(argv[0]);
+                         }
+                         outdir = argv[++i];
+                 } else if (strcmp(argv[i], "-jobs") == 0) {
+                         if (!(i + 1 < argc)) {      /* no job count */
+                                 usage(argv[0]);
+                         }
+                         char *endptr;
+                         jobs = strtol(argv[++i], &endptr, 10);
+                         if (*endptr != '\0' || jobs < 1) {
+                                 fprintf(stderr, "Jobs must be a positive "
+                                         "number\n");
+                                 usage(argv[0]);
+                         }
+                 } else if (strcmp(argv[i], "-threads") == 0) {
+                         if (!(i + 1 < argc)) {      /* no thread count */
+                                 usage(argv[0]);
+                         }
+                         char *endptr;
+                         long n = strtol(argv[++i], &endptr, 10);
+                         if (*endptr != '\0' || n < 1 || n > MAX_THREADS) {
+                                 fprintf(stderr, "Threads must be between 1 "
+                                         "and %d\n", MAX_THREADS);
+                                 usage(argv[0]);
+                         }
+                         threads = n;
+                 } else if (strcmp(argv[i], "-blocksize") == 0) {
+                         if (!(i + 1 < argc)) {      /* no block size */
+                                 usage(argv[0]);
+                         }
+                         char *endptr;
+                         long n = strtol(argv[++i], &endptr, 10);
+                         if (*endptr != '\0' || n < 1 || n > MAX_BLOCKSIZE) {
+                                 fprintf(stderr, "Block size must be between "
+                                         "1 and %d\n", MAX_BLOCKSIZE);
+                                 usage(argv[0]);
+                         }
+                         blocksize = n;
+                 } else if (strcmp(argv[i], "-blocksize-sweep") == 0) {
+                         if (!(i + 1 < argc)) {      /* no range */
+                                 usage(argv[0]);
+                         }
+                         int used = -1;
+                         sweep_step = 1;
+                         if (sscanf(argv[++i], "%d:%d%n:%d%n", &sweep_lo, 
+                                    &sweep_hi, &used, &sweep_step, 
+                                    &used) < 2 
+                             || argv[i][used] != '\0' || sweep_lo < 1 
+                             || sweep_hi < sweep_lo 
+                             || sweep_hi > MAX_BLOCKSIZE || sweep_step < 1
+                             || sweep_step > MAX_BLOCKSIZE) {
+                                 fprintf(stderr, "Sweep must be lo:hi or "
+                                         "lo:hi:step with 1 <= lo <= hi <= "
+                                         "%d and 1 <= step <= %d\n", 
+                                         MAX_BLOCKSIZE, MAX_BLOCKSIZE);
+                                 usage(argv[0]);
+                         }
+                         benchmark = true;
+                 } else if (strcmp(argv[i], "-benchmark") == 0) {
+                         benchmark = true;
+                 } else if (strcmp(argv[i], "-runs") == 0 
+                            || strcmp(argv[i], "-warmups") == 0) {
+                         if (!(i + 1 < argc)) {      /* no count */
+                                 usage(argv[0]);
+                         }
+                         bool is_runs = strcmp(argv[i], "-runs") == 0;
+                         char *endptr;
+                         long n = strtol(argv[++i], &endptr, 10);
+                         if (*endptr != '\0' || n < (is_runs ? 1 : 0) 
+                             || n > 1000000) {
+                                 fprintf(stderr, "Runs must be a positive "
+                                         "number, warmups a number\n");
+                                 usage(argv[0]);
+                         }
+                         if (is_runs) {
+                                 runs = n;
+                         } else {
+                                 warmups = n;
+                         }
+                 } else if (strcmp(argv[i], "-format") == 0) {
+                         if (!(i + 1 < argc)) {      /* no format */
+                                 usage(argv[0]);
+                         }
+                         i++;
+                         if (strcmp(argv[i], "csv") == 0) {
+                                 json = false;
+                         } else if (strcmp(argv[i], "json") == 0) {
+                                 json = true;
+                         } else {
+                                 fprintf(stderr, "Format must be 'csv' or "
+                                         "'json'\n");
+                                 usage(argv[0]);
+                         }
                  } else if (strcmp(argv[i], "-time") == 0) {
                          if (!(i + 1 < argc)) {      /* no time file */
                                  usage(argv[0]);
                          }
                          time_file_name = argv[++i];
-                         fprintf(stderr, "496\n");
+                 } else if (strcmp(argv[i], "-phases") == 0) {
+                         if (!(i + 1 < argc)) {      /* no phases file */
+                                 usage(argv[0]);
+                         }
+                         phases_file_name = argv[++i];
+                 } else if (strcmp(argv[i], "-counters") == 0) {
+                         counters = true;
+                 } else if (strcmp(argv[i], "-trace") == 0) {
+                         if (!(i + 1 < argc)) {      /* no trace file */
+                                 usage(argv[0]);
+                         }
+                         trace_file_name = argv[++i];
+                 } else if (strcmp(argv[i], "-plan") == 0) {
+                         plan = true;
+                 } else if (strcmp(argv[i], "-unpacked") == 0) {
+                         unpacked = true;
+                 } else if (strcmp(argv[i], "-cachesim") == 0) {
+                         cachesim = true;
+                 } else if (strcmp(argv[i], "-cache") == 0) {
+                         if (!(i + 1 < argc)) {      /* no cache */
+                                 usage(argv[0]);
+                         }
+                         if (ncaches == CACHESIM_MAX_LEVELS) {
+                                 fprintf(stderr, "At most %d -cache "
+                                         "levels\n", CACHESIM_MAX_LEVELS);
+                                 usage(argv[0]);
+                         }
+                         char *text = argv[++i];
+                         char *slash = strchr(text, '/');
+                         Cachesim_level *level = &caches[ncaches];
+                         int used = -1;
+                         if (slash != NULL) {
+                                 *slash = '\0';
+                                 level->size = parse_memory(text);
+                                 *slash = '/';
+                                 sscanf(slash, "/%d/%d%n", &level->ways,
+                                        &level->line, &used);
+                         }
+                         if (used < 0 || slash[used] != '\0' 
+                             || level->ways < 1 || level->line < 1 
+                             || (level->line & (level->line - 1)) != 0
+                             || level->size / level->ways 
+                                < (size_t)level->line) {
+                                 fprintf(stderr, "Cache must be "
+                                         "size/ways/line, with a line of a "
+                                         "power of two bytes\n");
+                                 usage(argv[0]);
+                         }
+                         ncaches++;
+                         cachesim = true;
                  } else if (*argv[i] == '-') {
                          fprintf(stderr, "%s: unknown option '%s'\n", argv[0],
                                  argv[i]);
                          usage(argv[0]);
-                 } else if (argc - i > 1) {
+                 } else {
+                         files[(*nfiles)++] = argv[i];
+                 }
+         }
+
+         if (warp && !A2Affine_invertible(matrix)) {
+                 fprintf(stderr, "%s: the transform squashes the image "
+                         "flat\n", argv[0]);
+                 usage(argv[0]);
+         }
+
+         if (ncaches == 0) {
+                 ncaches = Cachedriver_defaults(caches);
+         }
+         struct Options options = {
+                 .methods = methods, .map = map, .kind = kind,
+                 .warp = warp, .matrix = matrix, .sampling = sampling,
+                 .scale = scale,
+                 .crop = crop, .crop_x = crop_x, .crop_y = crop_y,
+                 .crop_width = crop_width, .crop_height = crop_height,
+                 .in_place = in_place, .stream = stream,
+                 .memory = memory, 
+                 .time_file_name = time_file_name,
+                 .phases_file_name = phases_file_name,
+                 .counters = counters,
+                 .trace_file_name = trace_file_name,
+                 .plan = plan, .unpacked = unpacked,
+                 .outdir = outdir, 
+                 .jobs = jobs > 0 ? (int)jobs : 1,
+                 .threads = threads,
+                 .benchmark = benchmark, .runs = runs, .warmups = warmups,
+                 .format = json ? FORMAT_JSON : FORMAT_CSV,
+                 .blocksize = blocksize, .sweep_lo = sweep_lo, 
+                 .sweep_hi = sweep_hi, .sweep_step = sweep_step,
+                 .cachesim = cachesim, .ncaches = ncaches
+         };
+         memcpy(options.caches, caches, sizeof(caches));
+         if (blocksize > 0 && !benchmark 
+             && methods != uarray2_methods_blocked) {
+                 fprintf(stderr, "-blocksize needs -block-major\n");
+                 usage(argv[0]);
+         }
+         if (cachesim && (resamples(&options) || outdir != NULL)) {
+                 fprintf(stderr, "-cachesim models one -rotate, -flip, "
+                         "-transpose or -transverse\n");
+                 usage(argv[0]);
+         }
+         if (trace_file_name != NULL 
+             && (resamples(&options) || outdir != NULL)) {
+                 fprintf(stderr, "-trace records one -rotate, -flip, "
+                         "-transpose or -transverse of one image\n");
+                 usage(argv[0]);
+         }
+         if (plan && resamples(&options)) {
+                 fprintf(stderr, "-plan plans a -rotate, -flip, -transpose "
+                         "or -transverse\n");
+                 usage(argv[0]);
+         }
+         if (counters && phases_file_name == NULL && !benchmark) {
+                 fprintf(stderr, "-counters needs -phases or -benchmark\n");
+                 usage(argv[0]);
+         }
+         if (counters) {
+                 Perfcount_T probe = Perfcount_New();
+                 if (!Perfcount_any(probe)) {
+                         fprintf(stderr, "%s: hardware counters are not "
+                                 "available here; timing only\n", argv[0]);
+                 }
+                 Perfcount_Free(&probe);
+         }
+         return options;
+ }
+
+ int main(int argc, char *argv[])
+ {
+         char **files = malloc(argc * sizeof(*files));
+         assert(files != NULL);
+         int nfiles = 0;
+         struct Options options = parse_options(argc, argv, files, &nfiles);
+
+         int ok = 0;
+         FILE *fp;
+
+         if (options.outdir != NULL) {
+                 int failures = Batch_run(&options, files, nfiles);
+                 free(files);
+                 return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+         }
+         if (options.benchmark || options.cachesim) {
+                 if (nfiles > 1) {
                          fprintf(stderr, "Too many arguments\n");
                          usage(argv[0]);
+                 }
+                 fp = nfiles == 1 ? fopen(files[0], "rb") : stdin;
+                 assert(fp != NULL);
+                 if (options.benchmark) {
+                         Benchmark_run(fp, &options);
                  } else {
-                        fprintf(stderr, argv[i]);
-                        fp = fopen(argv[i], "rb");
-                        ok = 1;
+                         Cachedriver_run(fp, &options);
+                 }
+                 if (fp != stdin) {
+                         fclose(fp);
                  }
+                 free(files);
+                 return EXIT_SUCCESS;
          }
+         struct Phases phases_store;
+         struct Phases *phases = NULL;
+         if (options.phases_file_name != NULL) {
+                 Phases_init(&phases_store, false, options.counters);
+                 phases = &phases_store;
+         }
+         const char *path = NULL;
+
+         Phases_start(phases);
+         if (nfiles > 1) {
+                 fprintf(stderr, "Too many arguments\n");
+                 usage(argv[0]);
+         } else if (nfiles == 1) {
+                fp = fopen(files[0], "rb");
+                path = files[0];
+                ok = 1;
+         }
+         free(files);
  
         if (ok == 0) {
                 fp = stdin;
         }        
+         Phases_stop(phases, PHASE_OPEN);
 
         //  if (argc == 1) { /* nothing provided */
         //          fp = stdin;
         //  } else 
-         if (rotation != 0  && flip_type != NULL) { /* can't rotate and 
-                                                         flip */
-                 fprintf(stderr, "Too many arguments\n"); 
-                 return EXIT_FAILURE;
-         }
         //  } else {
         //          fp = fopen(argv[argc - 1], "rb"); /*open file*/ 
         //          if (fp == NULL) {
@@ -586,7 +2004,37 @@
  
         //  }
  
-         execution(fp, methods, map, rotation, flip_type, timer, time_file_name, time_used);
+         /* Create a timer; the threads of -threads run at once, so 
+         theirs is the time that passes rather than the CPU time they add
+         up to */
+         CPUTime_T timer = options.threads > 1 ? CPUTime_NewWall() 
+                                               : CPUTime_New();
+
+         /* -stream reads the image through ppmstream rather than into 
+         an array of the chosen representation; a format other than P6 
+         goes into the array regardless */
+         int magic = 0;
+         bool streams = options.stream && !resamples(&options) 
+                        && options.trace_file_name == NULL
+                        && Ppmstream_can_transform(options.kind);
+         if (streams) {
+                 magic = Ppmstream_read_magic(fp);
+         }
+         if (magic == '6') {
+                 stream_execution(fp, &options, timer, phases, path);
+         } else {
+                 if (streams) {
+                         FILE *whole = Ppmstream_unread_magic(fp, magic);
+                         if (whole != fp) {
+                                 fclose(fp);
+                                 fp = whole;
+                         }
+                 }
+                 execution(fp, &options, timer, phases, path);
+         }
+         if (phases != NULL) {
+                 Phases_free(phases);
+         }
          // if (rotation != 0) {
          //         execution(fp, methods, map, rotation, NULL, timer, time_file_name, time_used);
          // } else {
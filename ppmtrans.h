@@ -0,0 +1,160 @@
+/**************************************************************
+ *
+ *                     ppmtrans.h
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     What ppmtrans.c shares with the modes it hands a run over to
+ *     (batch.c, benchmark.c and cachedriver.c) and with phases.c: the
+ *     options the command line asked for, and the parts of the transform
+ *     pipeline each mode puts together in its own way.
+ *
+ **************************************************************/
+
+#ifndef PPMTRANS_INCLUDED
+#define PPMTRANS_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "a2methods.h"
+#include "a2transform.h"
+#include "a2affine.h"
+#include "a2plan.h"
+#include "cachesim.h"
+#include "pnm.h"
+#include "ppmstream.h"
+#include "phases.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* everything the command line asked for */
+struct Options {
+        A2Methods_T methods;
+        A2Methods_mapfun *map;
+        A2Transform_T kind;
+        bool warp;              /* -angle or -affine: resample through 
+                                   matrix instead of applying kind */
+        A2Affine matrix;        /* the whole chain, kind included */
+        A2Sampling_T sampling;
+        int scale;              /* -scale 1/N shrinks by N; 1 if not */
+        bool crop;              /* -crop: only this part of the input */
+        unsigned crop_x, crop_y, crop_width, crop_height;
+        bool in_place, stream;
+        size_t memory;          /* -stream's budget */
+        char *time_file_name;
+        char *phases_file_name; /* -phases: one JSON line per image */
+        bool counters;          /* -counters: hardware events too */
+        char *trace_file_name;  /* -trace: every cell the transform 
+                                   touches goes here */
+        bool plan;              /* -plan: precompute where cells go */
+        bool unpacked;          /* -unpacked: Pnm_rgb pixels even when 
+                                   they would pack into 4 bytes */
+        char *outdir;           /* batch mode when not NULL */
+        int jobs;               /* files at a time in batch mode */
+        int threads;            /* threads per transform otherwise */
+        bool benchmark;         /* time every configuration instead */
+        int runs, warmups;      /* timed and untimed runs of each */
+        enum { FORMAT_CSV, FORMAT_JSON } format;
+        int blocksize;          /* -blocksize, 0 for the suite's own */
+        int sweep_lo, sweep_hi, sweep_step; /* -blocksize-sweep sizes; 
+                                               sweep_lo 0 if none */
+        bool cachesim;          /* simulate the caches instead */
+        int ncaches;            /* levels of -cache, nearest first */
+        Cachesim_level caches[CACHESIM_MAX_LEVELS];
+};
+
+/* the two arrays of a transform, as A2Watch labels them */
+enum { SOURCE, DESTINATION, NARRAYS };
+
+/* names of the transforms and traversals in reports */
+extern const char *const kind_names[];
+extern const char *const traversal_names[];
+
+/* the traversal a built-in suite's map function stands for */
+extern A2Traversal_T traversal_of(A2Methods_T methods, A2Methods_mapfun *map);
+
+/* the map of methods for a traversal, NULL if it has none */
+extern A2Methods_mapfun *map_of(A2Methods_T methods, A2Traversal_T order);
+
+/* the name -phases gives the suite of an array */
+extern const char *suite_name(A2Methods_T methods);
+
+/*
+ * applies kind to pixels, writing transImage, which has the transformed
+ * dimensions, visiting the source in the order map gives
+ */
+extern void transform_into(A2Methods_T methods, A2Methods_mapfun *map,
+                           A2Transform_T kind, A2 pixels, A2 transImage);
+
+/*
+ * makes *plan (NULL at first) a plan for transforming pixels into
+ * transImage, keeping the one there if it fits them; false, with *plan
+ * as it was, if the suite's storage is not one the transform engine
+ * can see
+ */
+extern bool fit_plan(A2Plan_T *plan, A2Methods_T methods,
+                     A2Methods_mapfun *map, A2Transform_T kind, A2 pixels,
+                     A2 transImage);
+
+/* transform_into through a plan fit_plan has made for the two arrays */
+extern void planned_transform_into(A2Plan_T plan, A2Methods_T methods,
+                                   A2 pixels, A2 transImage);
+
+/*
+ * true if the pixels are resampled rather than moved: the image is
+ * shrunk, or goes through a matrix
+ */
+extern bool resamples(const struct Options *options);
+
+/* resamples pixels through options' scale and matrix into transImage */
+extern void resample_into(const struct Options *options, A2 pixels,
+                          A2 transImage);
+
+/* the dimensions the command line turns a width x height image into */
+extern void result_dims(const struct Options *options, int width,
+                        int height, int *new_width, int *new_height);
+
+/* true if transform_in_place can apply kind to such an image */
+extern bool can_transform_in_place(A2Methods_T methods, A2Transform_T kind,
+                                   int width, int height);
+
+/* applies kind to image without a second array */
+extern void transform_in_place(A2Methods_T methods, A2Transform_T kind,
+                               Pnm_ppm image);
+
+/*
+ * narrows stream to the -crop rectangle, if there is one; false if the
+ * rectangle does not fit in the image
+ */
+extern bool crop_stream(const struct Options *options, Ppmstream_T stream);
+
+/*
+ * bytes in each pixel of an image with this denominator: a packed
+ * Ppmstream_rgb8 where options allow it, otherwise a Pnm_rgb
+ */
+extern int pixel_size(const struct Options *options, unsigned denominator);
+
+/*
+ * a width x height array of pixels of 'size' bytes in the chosen suite,
+ * with the -blocksize if one was given
+ */
+extern A2 new_pixels(const struct Options *options, int width, int height,
+                     int size);
+
+/*
+ * reads the image in fp, or its -crop rectangle, into an array of the
+ * chosen suite, block size and pixel size, adding to the parse and
+ * alloc phases (phases may be NULL)
+ */
+extern Pnm_ppm read_image(FILE *fp, const struct Options *options,
+                          struct Phases *phases);
+
+/* appends a line giving time_used per pixel to the -time file */
+extern void write_the_timing(const char *time_file_name, double time_used,
+                             int width, int height);
+
+#endif
@@ -0,0 +1,256 @@
+#!/bin/sh
+#
+#                     test_ppmtrans.sh
+#
+#     Assignment: locality
+#     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+#
+#     summary
+#     Command-line tests of ppmtrans, for what a2test cannot reach: the
+#     exit statuses, messages and files of the options as a user runs
+#     them.  Usage: sh test_ppmtrans.sh [path to ppmtrans]; make check
+#     runs it after a2test.  The JSON checks need python3 and are
+#     skipped without it.
+#
+
+PPMTRANS=${1:-./ppmtrans}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+failures=0
+
+fail()
+{
+        echo "FAIL: $*" >&2
+        failures=$((failures + 1))
+}
+
+# make_ppm file width height: a P6 of random pixels
+make_ppm()
+{
+        {
+                printf 'P6\n%d %d\n255\n' "$2" "$3"
+                head -c $(($2 * $3 * 3)) /dev/urandom
+        } > "$1"
+}
+
+# has_python: true if the JSON checks can run
+has_python()
+{
+        command -v python3 > /dev/null 2>&1
+}
+
+make_ppm "$dir/image.ppm" 37 23
+
+## Batch mode (-outdir)
+
+mkdir "$dir/in" "$dir/a" "$dir/b"
+make_ppm "$dir/in/x.ppm" 13 9
+cp "$dir/in/x.ppm" "$dir/x.orig"
+
+# an output that is its own input is refused rather than truncated
+if "$PPMTRANS" -rotate 90 -outdir "$dir/in" "$dir/in/x.ppm" 2> "$dir/err"
+then
+        fail "batch: an input that is its own output succeeded"
+fi
+cmp -s "$dir/in/x.ppm" "$dir/x.orig" \
+        || fail "batch: the input was changed"
+grep -q 'is its own output' "$dir/err" \
+        || fail "batch: no message for an input that is its own output"
+[ "$(ls "$dir/in")" = x.ppm ] || fail "batch: files left beside the input"
+
+# of two inputs with one name the first is written, the second fails
+make_ppm "$dir/a/y.ppm" 5 4
+make_ppm "$dir/b/y.ppm" 6 3
+if "$PPMTRANS" -rotate 90 -outdir "$dir/out" "$dir/a/y.ppm" "$dir/b/y.ppm" \
+               "$dir/image.ppm" 2> "$dir/err"
+then
+        fail "batch: colliding outputs succeeded"
+fi
+grep -q "b/y.ppm: same output as .*a/y.ppm" "$dir/err" \
+        || fail "batch: no message for colliding outputs"
+"$PPMTRANS" -rotate 90 "$dir/a/y.ppm" > "$dir/y.ppm"
+cmp -s "$dir/y.ppm" "$dir/out/y.ppm" \
+        || fail "batch: the first of two colliding inputs was not kept"
+
+# each output is what ppmtrans writes for that file alone, and nothing
+# else is left in the directory
+"$PPMTRANS" -rotate 90 "$dir/image.ppm" > "$dir/image90.ppm"
+cmp -s "$dir/image90.ppm" "$dir/out/image.ppm" \
+        || fail "batch: output differs from a single run"
+[ "$(ls "$dir/out" | wc -l)" -eq 2 ] \
+        || fail "batch: unexpected files in the output directory"
+
+# a manifest on stdin collides the same way
+printf '%s\n%s\n' "$dir/a/y.ppm" "$dir/b/y.ppm" \
+        | "$PPMTRANS" -rotate 90 -outdir "$dir/out2" 2> /dev/null \
+        && fail "batch: colliding outputs from stdin succeeded"
+
+## -crop
+
+# a crop that does not fit is an error, and writes no image
+if "$PPMTRANS" -crop 30,20,8,4 "$dir/image.ppm" > "$dir/crop.ppm" \
+               2> "$dir/err"
+then
+        fail "crop: a crop past the right edge succeeded"
+fi
+grep -q 'does not fit' "$dir/err" || fail "crop: no message for a bad crop"
+[ -s "$dir/crop.ppm" ] && fail "crop: an image was written for a bad crop"
+"$PPMTRANS" -crop 0,23,1,1 "$dir/image.ppm" > /dev/null 2>&1 \
+        && fail "crop: a crop below the image succeeded"
+"$PPMTRANS" -crop 30,20,8,4 -outdir "$dir/cropped" "$dir/image.ppm" \
+            2> "$dir/err" && fail "crop: a bad crop in a batch succeeded"
+grep -q 'crop does not fit in the image' "$dir/err" \
+        || fail "crop: no message for a bad crop in a batch"
+
+# the whole image as a crop is the image, and a crop is the same read 
+# into an array, streamed, or in a batch
+"$PPMTRANS" -rotate 90 -crop 0,0,37,23 "$dir/image.ppm" > "$dir/crop.ppm"
+cmp -s "$dir/crop.ppm" "$dir/image90.ppm" \
+        || fail "crop: the whole image differs from no crop"
+"$PPMTRANS" -rotate 270 -crop 29,15,8,8 "$dir/image.ppm" > "$dir/crop.ppm"
+"$PPMTRANS" -rotate 270 -crop 29,15,8,8 -stream "$dir/image.ppm" \
+            > "$dir/stream.ppm"
+cmp -s "$dir/crop.ppm" "$dir/stream.ppm" \
+        || fail "crop: -stream differs from the array path"
+"$PPMTRANS" -rotate 270 -crop 29,15,8,8 -outdir "$dir/cropped" \
+            "$dir/image.ppm"
+cmp -s "$dir/crop.ppm" "$dir/cropped/image.ppm" \
+        || fail "crop: a batch differs from a single run"
+
+# only a P6 can be cropped
+printf 'P3\n2 2\n255\n1 2 3 4 5 6 7 8 9 10 11 12\n' > "$dir/plain.ppm"
+"$PPMTRANS" -crop 0,0,1,1 "$dir/plain.ppm" > /dev/null 2> "$dir/err" \
+        && fail "crop: a P3 was cropped"
+grep -q 'needs a binary' "$dir/err" || fail "crop: no message for a P3"
+
+## -benchmark
+
+bench="-benchmark -runs 2 -warmups 0"
+header="transform,traversal,blocksize,width,height,runs,median_ns,min_ns,"
+header="${header}max_ns,p25_ns,p75_ns"
+
+# one CSV row of 11 columns for each transform by row-major, col-major
+# and the distinct block sizes; packed, the default block size is 128, 
+# which is also on the list
+"$PPMTRANS" $bench "$dir/image.ppm" > "$dir/bench.csv" \
+        || fail "benchmark: failed"
+[ "$(head -n 1 "$dir/bench.csv")" = "$header" ] \
+        || fail "benchmark: wrong CSV header"
+awk -F, 'NR > 1 && NF != 11 { bad = 1 } END { exit bad }' "$dir/bench.csv" \
+        || fail "benchmark: a CSV row without 11 columns"
+[ "$(tail -n +2 "$dir/bench.csv" | wc -l)" -eq $((8 * 7)) ] \
+        || fail "benchmark: wrong number of rows"
+[ "$(cut -d, -f1-3 "$dir/bench.csv" | sort | uniq -d)" = "" ] \
+        || fail "benchmark: a configuration timed twice"
+"$PPMTRANS" $bench -unpacked "$dir/image.ppm" > "$dir/bench.csv"
+[ "$(tail -n +2 "$dir/bench.csv" | wc -l)" -eq $((8 * 8)) ] \
+        || fail "benchmark: wrong number of rows unpacked"
+
+# the same rows as a JSON array
+if has_python; then
+        "$PPMTRANS" $bench -format json "$dir/image.ppm" \
+                | python3 -c '
+import json, sys
+rows = json.load(sys.stdin)
+assert len(rows) == 8 * 7
+for row in rows:
+        assert set(row["ns_per_pixel"]) == {"median", "min", "max", "p25",
+                                            "p75"}
+        assert row["width"] == 37 and row["height"] == 23
+' || fail "benchmark: bad JSON"
+fi
+
+## -blocksize and -blocksize-sweep
+
+# -blocksize N makes block-major arrays of N x N blocks
+"$PPMTRANS" -rotate 90 -block-major -blocksize 8 -phases "$dir/phases" \
+            "$dir/image.ppm" > "$dir/block.ppm"
+grep -q '"methods": "blocked", "blocksize": 8,' "$dir/phases" \
+        || fail "blocksize: the arrays were not 8 x 8 blocks"
+cmp -s "$dir/block.ppm" "$dir/image90.ppm" \
+        || fail "blocksize: output differs from the default"
+rm -f "$dir/phases"
+"$PPMTRANS" $bench -blocksize 16 "$dir/image.ppm" > "$dir/bench.csv"
+[ "$(grep -c ',block-major,16,' "$dir/bench.csv")" -eq 8 ] \
+        || fail "blocksize: -benchmark did not time 16 for each transform"
+[ "$(grep -c ',block-major,' "$dir/bench.csv")" -eq 8 ] \
+        || fail "blocksize: -benchmark timed other block sizes"
+"$PPMTRANS" -blocksize 0 "$dir/image.ppm" > /dev/null 2>&1 \
+        && fail "blocksize: a block size of 0 was accepted"
+
+# the sweep times the asked-for transform at lo, lo + step, ... <= hi
+"$PPMTRANS" $bench -rotate 90 -blocksize-sweep 8:30:8 "$dir/image.ppm" \
+            > "$dir/sweep.csv" || fail "sweep: failed"
+[ "$(tail -n +2 "$dir/sweep.csv" | cut -d, -f3 | tr '\n' ' ')" = "8 16 24 " ] \
+        || fail "sweep: wrong block sizes"
+[ "$(tail -n +2 "$dir/sweep.csv" | cut -d, -f1,2 | sort -u)" \
+  = "rotate-90,block-major" ] || fail "sweep: wrong transform or traversal"
+
+## -phases
+
+# one JSON line per run, appended, with every phase timed
+"$PPMTRANS" -rotate 90 -phases "$dir/phases" "$dir/image.ppm" > /dev/null
+"$PPMTRANS" -rotate 90 -stream -phases "$dir/phases" "$dir/image.ppm" \
+            > /dev/null
+"$PPMTRANS" -rotate 90 -phases "$dir/phases" -outdir "$dir/timed" \
+            "$dir/image.ppm" "$dir/a/y.ppm"
+[ "$(wc -l < "$dir/phases")" -eq 4 ] || fail "phases: wrong number of lines"
+if has_python; then
+        python3 -c '
+import json, sys
+for line in open(sys.argv[1]):
+        run = json.loads(line)
+        assert set(run["phases"]) == {"open", "parse", "alloc", "transform",
+                                      "write", "free"}
+        for phase in run["phases"].values():
+                assert phase["wall_ns"] >= 0 and phase["cpu_ns"] >= 0
+        assert (run["new_width"], run["new_height"]) \
+               == (run["height"], run["width"])
+' "$dir/phases" || fail "phases: bad JSON"
+fi
+
+## -counters
+
+# each count is a number or, for an event the machine cannot count, 
+# null in JSON and empty in CSV; where perf_event_open is not available
+# at all every one is
+"$PPMTRANS" -rotate 90 -counters -phases "$dir/counted" "$dir/image.ppm" \
+            > /dev/null 2> "$dir/err"
+"$PPMTRANS" $bench -counters "$dir/image.ppm" > "$dir/bench.csv" 2> /dev/null
+if grep -q 'not available' "$dir/err"; then
+        counted=false
+else
+        counted=true
+fi
+[ "$(head -n 1 "$dir/bench.csv" | awk -F, '{ print NF }')" -eq 16 ] \
+        || fail "counters: wrong CSV header"
+awk -F, -v counted=$counted '
+        NR > 1 && NF != 16 { bad = 1 }
+        NR > 1 { 
+                for (i = 12; i <= NF; i++) {
+                        empty = $i == ""
+                        if (!empty && (counted == "false" || $i !~ /^[0-9.]+$/))
+                                bad = 1
+                }
+        }
+        END { exit bad }' "$dir/bench.csv" || fail "counters: bad CSV counts"
+if has_python; then
+        python3 -c '
+import json, sys
+counted = sys.argv[2] == "true"
+events = {"cycles", "instructions", "l1d_misses", "llc_misses",
+          "dtlb_misses"}
+run = json.loads(open(sys.argv[1]).readline())
+for phase in run["phases"].values():
+        assert events <= set(phase)
+        for event in events:
+                count = phase[event]
+                assert count is None or (counted and count >= 0)
+' "$dir/counted" $counted || fail "counters: bad JSON counts"
+fi
+
+if [ "$failures" -ne 0 ]; then
+        echo "$failures failed."
+        exit 1
+fi
+echo "Passed."
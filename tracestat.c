@@ -0,0 +1,249 @@
+/**************************************************************
+ *
+ *                     tracestat.c
+ *
+ *     Assignment: locality
+ *     Authors: Alejandra Sabater (asabat01), Darius-Stefan Iavorschi (diavor01)
+ *
+ *     summary
+ *     Summarises an access trace written by ppmtrans -trace (see
+ *     a2trace.h).  For each array it gives the number of accesses of
+ *     each kind, the most common strides between one access and the
+ *     next, and how many times the accesses moved from one block to
+ *     another, where a block is a block of a blocked array and a row
+ *     of a plain one: the unit of storage that is contiguous.
+ *
+ *     Usage: tracestat [-top N] [trace_file]
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "assert.h"
+#include "a2trace.h"
+
+/* arrays a trace can hold, by label + 1 (0 is every unlabelled one) */
+#define NSLOTS (A2TRACE_MAX_LABEL + 2)
+
+/* a stride and how often it was seen, in an open-addressed table */
+struct stride {
+        int64_t bytes;
+        uint64_t count;
+        bool used;
+};
+
+/* all that is kept about one array */
+struct array_stats {
+        bool described, seen;
+        uintptr_t base;
+        int width, height, size, blocksize;
+        uint64_t accesses[2], bytes;    /* by A2Watch_kind */
+        uintptr_t last;
+        uint64_t last_block, block_transitions;
+        struct stride *strides;
+        size_t nstrides, capacity;
+};
+
+static struct array_stats arrays[NSLOTS];
+
+/* the entry for bytes in a table of capacity entries (a power of two,
+ * never full), made with a count of 0 if there was none */
+static struct stride *stride_entry(struct stride *table, size_t capacity,
+                                   int64_t bytes)
+{
+        size_t at = (size_t)(((uint64_t)bytes * 0x9e3779b97f4a7c15ull)
+                             >> 32) & (capacity - 1);
+        while (table[at].used && table[at].bytes != bytes) {
+                at = (at + 1) & (capacity - 1);
+        }
+        if (!table[at].used) {
+                table[at].used = true;
+                table[at].bytes = bytes;
+        }
+        return &table[at];
+}
+
+static void count_stride(struct array_stats *stats, int64_t bytes)
+{
+        /* kept at most half full, doubling as it fills */
+        if (2 * (stats->nstrides + 1) > stats->capacity) {
+                size_t capacity = stats->capacity == 0 
+                                  ? 64 : 2 * stats->capacity;
+                struct stride *table = calloc(capacity, sizeof(*table));
+                assert(table != NULL);
+                for (size_t i = 0; i < stats->capacity; i++) {
+                        if (stats->strides[i].used) {
+                                stride_entry(table, capacity, 
+                                             stats->strides[i].bytes)->count
+                                        = stats->strides[i].count;
+                        }
+                }
+                free(stats->strides);
+                stats->strides = table;
+                stats->capacity = capacity;
+        }
+        struct stride *entry = stride_entry(stats->strides, stats->capacity,
+                                            bytes);
+        if (entry->count == 0) {
+                stats->nstrides++;
+        }
+        entry->count++;
+}
+
+/* the contiguous unit of storage holding address: a block of a blocked
+ * array, a row of a plain one */
+static uint64_t block_of(const struct array_stats *stats, uintptr_t address)
+{
+        uint64_t offset = address - stats->base;
+        uint64_t bs = stats->blocksize;
+        uint64_t block_bytes = bs > 1 ? bs * bs * stats->size
+                                      : (uint64_t)stats->width * stats->size;
+        return block_bytes > 0 ? offset / block_bytes : 0;
+}
+
+static void record_access(const A2Trace_record *record)
+{
+        struct array_stats *stats = &arrays[record->label + 1];
+
+        if (stats->seen) {
+                count_stride(stats, (int64_t)(record->address - stats->last));
+        }
+        if (stats->described) {
+                uint64_t block = block_of(stats, record->address);
+                if (stats->seen && block != stats->last_block) {
+                        stats->block_transitions++;
+                }
+                stats->last_block = block;
+        }
+        stats->seen = true;
+        stats->last = record->address;
+        stats->accesses[record->kind]++;
+        stats->bytes += record->bytes;
+}
+
+static int compare_counts(const void *a, const void *b)
+{
+        const struct stride *x = a;
+        const struct stride *y = b;
+        return (x->count < y->count) - (x->count > y->count);
+}
+
+static void print_stats(int label, struct array_stats *stats, int top)
+{
+        uint64_t total = stats->accesses[A2WATCH_AT]
+                         + stats->accesses[A2WATCH_MAP];
+        if (label < 0) {
+                printf("unlabelled arrays\n");
+        } else if (stats->described) {
+                printf("array %d: %dx%d, %d-byte cells, blocksize %d\n",
+                       label, stats->width, stats->height, stats->size,
+                       stats->blocksize);
+        } else {
+                printf("array %d\n", label);
+        }
+        printf("  accesses: %" PRIu64 " (%" PRIu64 " at, %" PRIu64
+               " map), %" PRIu64 " bytes\n", total,
+               stats->accesses[A2WATCH_AT], stats->accesses[A2WATCH_MAP],
+               stats->bytes);
+        if (stats->described) {
+                printf("  %s transitions: %" PRIu64 " (%.1f accesses per "
+                       "visit)\n", stats->blocksize > 1 ? "block" : "row",
+                       stats->block_transitions,
+                       (double)total / (stats->block_transitions + 1));
+        }
+
+        /* the table is done with, so it is sorted in place */
+        size_t n = 0;
+        for (size_t i = 0; i < stats->capacity; i++) {
+                if (stats->strides[i].used) {
+                        stats->strides[n++] = stats->strides[i];
+                }
+        }
+        qsort(stats->strides, n, sizeof(*stats->strides), compare_counts);
+        uint64_t strides = total > 0 ? total - 1 : 0;
+        uint64_t shown = 0;
+        printf("  strides (bytes):\n");
+        for (size_t i = 0; i < n && (int)i < top; i++) {
+                struct stride *s = &stats->strides[i];
+                printf("    %+14" PRId64, s->bytes);
+                if (stats->described && stats->size > 0
+                    && s->bytes % stats->size == 0) {
+                        printf(" (%+" PRId64 " cells)",
+                               s->bytes / stats->size);
+                }
+                printf(": %" PRIu64 " (%.2f%%)\n", s->count,
+                       100.0 * s->count / strides);
+                shown += s->count;
+        }
+        if (shown < strides) {
+                printf("    %14s: %" PRIu64 " (%.2f%%) in %zu other "
+                       "strides\n", "other", strides - shown,
+                       100.0 * (strides - shown) / strides, n - top);
+        }
+}
+
+static void usage(const char *progname)
+{
+        fprintf(stderr, "Usage: %s [-top N] [trace_file]\n", progname);
+        exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+        int top = 8;
+        FILE *fp = stdin;
+        int i = 1;
+
+        if (i + 1 < argc && strcmp(argv[i], "-top") == 0) {
+                char *endptr;
+                top = strtol(argv[i + 1], &endptr, 10);
+                if (*endptr != '\0' || top < 1) {
+                        usage(argv[0]);
+                }
+                i += 2;
+        }
+        if (i + 1 < argc) {
+                usage(argv[0]);
+        } else if (i < argc) {
+                fp = fopen(argv[i], "rb");
+                if (fp == NULL) {
+                        perror(argv[i]);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        A2Trace_T trace = A2Trace_reader(fp);
+        if (trace == NULL) {
+                fprintf(stderr, "%s: not an access trace\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        A2Trace_record record;
+        while (A2Trace_read(trace, &record)) {
+                if (!record.is_array) {
+                        record_access(&record);
+                        continue;
+                }
+                struct array_stats *stats = &arrays[record.label + 1];
+                stats->described = true;
+                stats->base = record.address;
+                stats->width = record.width;
+                stats->height = record.height;
+                stats->size = record.size;
+                stats->blocksize = record.blocksize;
+        }
+        A2Trace_free(&trace);
+        if (fp != stdin) {
+                fclose(fp);
+        }
+
+        for (int slot = 0; slot < NSLOTS; slot++) {
+                if (arrays[slot].seen) {
+                        print_stats(slot - 1, &arrays[slot], top);
+                }
+                free(arrays[slot].strides);
+        }
+        return EXIT_SUCCESS;
+}
@@ -216,7 +216,7 @@ void *UArray2b_at(UArray2b_T array2b, int column, int row)
         assert(row < array2b->height);
 
         int blocksize = array2b->blocksize; 
-        int blocks_per_row = array2b->width / blocksize;
+        int blocks_per_row = (array2b->width + blocksize - 1) / blocksize;
 
         int block_row = row / blocksize;
         int block_col = column / blocksize;
@@ -282,4 +282,104 @@ void UArray2b_map(UArray2b_T array2b, void apply(int col, int row, UArray2b_T ar
 
 }
 
+/********** UArray2b_map_spans ********
+ *
+ * Visits the array block by block like UArray2b_map, but calls apply
+ * once per row of each block instead of once per cell
+ *
+ * Parameters:
+ *      UArray2b_T array2b: the array being mapped
+ *      apply: called with a pointer to the first cell of the run, the
+ *             number of cells in the run, and the column and row of
+ *             that first cell
+ *      void *cl: closure passed through to apply
+ *
+ * Return: 
+ *      None
+ *
+ * Expects: 
+ *      array2b and apply must not be NULL
+ *      
+ * Notes:
+ *      The cells of one block row are stored next to each other, so
+ *      apply may walk a run with plain pointer arithmetic.  Runs in the
+ *      last block column are cut short at the width of the array, and
+ *      block rows past the height are skipped entirely.
+ ************************/
+void UArray2b_map_spans(UArray2b_T array2b, void apply(void *elem, int count,
+                        int col, int row, void *cl), void *cl)
+{
+        assert(array2b != NULL);
+        assert(apply != NULL);
+
+        int blocksize = array2b->blocksize;
+        int cells_per_block = blocksize * blocksize;
+
+        int num_blocks_wide = (array2b->width + blocksize - 1) / blocksize;
+        int num_blocks_high = (array2b->height + blocksize - 1) / blocksize;
+
+        for (int block_row = 0; block_row < num_blocks_high; block_row++) {
+                int row0 = block_row * blocksize;
+                int rows = array2b->height - row0;
+                if (rows > blocksize) {
+                        rows = blocksize;
+                }
+
+                for (int block_col = 0; block_col < num_blocks_wide; 
+                     block_col++) {
+                        int col = block_col * blocksize;
+                        int count = array2b->width - col;
+                        if (count > blocksize) {
+                                count = blocksize;
+                        }
 
+                        int block_index = block_row * num_blocks_wide 
+                                          + block_col;
+                        char *block = UArray_at(array2b->array, 
+                                                block_index * cells_per_block);
+
+                        for (int in_block_row = 0; in_block_row < rows; 
+                             in_block_row++) {
+                                apply(block + in_block_row * blocksize 
+                                              * array2b->size,
+                                      count, col, row0 + in_block_row, cl);
+                        }
+                }
+        }
+}
+
+/********** UArray2b_reshape ********
+ *
+ * Gives the array new dimensions over the same storage, without moving
+ * any cells
+ *
+ * Parameters:
+ *      UArray2b_T array2b: the array
+ *      int width, height: the new dimensions
+ *
+ * Return: 
+ *      None
+ *
+ * Expects: 
+ *      array2b must not be NULL, and the new shape must need exactly as
+ *      many blocks as the old one (checked runtime error).  Swapping
+ *      width and height always qualifies.
+ *      
+ * Notes:
+ *      Used after an in-place quarter turn has already permuted the
+ *      cells into the order of the new shape
+ ************************/
+void UArray2b_reshape(UArray2b_T array2b, int width, int height)
+{
+        assert(array2b != NULL);
+
+        int blocksize = array2b->blocksize;
+        int old_blocks = ((array2b->width + blocksize - 1) / blocksize)
+                         * ((array2b->height + blocksize - 1) / blocksize);
+        int new_blocks = ((width + blocksize - 1) / blocksize)
+                         * ((height + blocksize - 1) / blocksize);
+        assert(old_blocks == new_blocks);
+
+        array2b->width = width;
+        array2b->height = height;
+}
@@ -3,6 +3,14 @@
 #define T UArray2b_T
 typedef struct T *T;
 
+/*
+* cells live in one UArray: blocks are stored in row-major order of
+* blocks, and the cells of each block in row-major order within it,
+* so cell (col, row) is at index
+*   (row / bs * blocks_wide + col / bs) * bs * bs + (row % bs) * bs + col % bs
+* where blocks_wide = ceil(width / bs) (see A2Layout in a2transform.h)
+*/
+
 /*
 * new blocked 2d array
 * blocksize = square root of # of cells in block.
@@ -26,6 +34,18 @@ extern void *UArray2b_at(T array2b, int column, int row);
 // /* visits every cell in one block before moving to another block */
 extern void UArray2b_map(T array2b, void apply(int col, int row, T array2b, void *elem, void *cl), void *cl);
 
+/* same order as UArray2b_map, but apply sees one row of one block at a
+ * time: 'count' cells starting at (col, row), adjacent in memory
+ */
+extern void UArray2b_map_spans(T array2b, void apply(void *elem, int count,
+                               int col, int row, void *cl), void *cl);
+
+/* new dimensions over the same storage; no cells move.  The new shape
+* must need as many blocks as the old one (checked run-time error),
+* which is always true of swapping width and height
+*/
+extern void UArray2b_reshape(T array2b, int width, int height);
+
 /*
 * it is a checked run-time error to pass a NULL T
 * to any function in this interface